@@ -34,6 +34,9 @@ isl::matrix to_isl_matrix(const affine_matrix & src, const isl::context & ctx, b
 
 isl::map to_isl_map(const stmt_ptr & stmt, const array_relation & relation)
 {
+    if (relation.map.get())
+        return relation.map;
+
     auto space = isl::space::from(stmt->domain.get_space(),
                                   relation.array->domain.get_space());
 #if 0
@@ -66,6 +69,13 @@ isl::map to_isl_map(const stmt_ptr & stmt, const array_relation & relation)
         map.add_constraint(o == e);
     }
 
+    if (relation.expr.size() < space.dimension(isl::space::output))
+    {
+        // Remaining dimensions span the entire array.
+        isl::map result = map;
+        return result.in_range(relation.array->domain);
+    }
+
     return map;
 }
 
@@ -67,10 +67,16 @@ struct array_relation
     array_relation(array_ptr a,
                    const isl::multi_expression & e):
         array(a), expr(e) {}
+    array_relation(array_ptr a,
+                   const isl::map & m):
+        array(a), map(m) {}
 
     array_ptr array = nullptr;
     // expr: Used to create polyhedral model summary in ISL:
     isl::multi_expression expr { nullptr };
+    // map: Used instead of expr for relations which are not functions,
+    // e.g. a statement reading an entire row of an array.
+    isl::map map { nullptr };
 };
 
 isl::map to_isl_map(const stmt_ptr &, const array_relation &);
@@ -156,6 +162,34 @@ public:
     vector<functional::expr_ptr> args;
 };
 
+// Transform of entire rows of the input array along its last dimension.
+// Rows are selected by the leading statement indexes.
+class transform_call : public functional::expression
+{
+public:
+    transform_call(const location_type & l = location_type()):
+        expression(l) {}
+
+    primitive_op kind;
+    array_ptr input;
+    int size = 0;
+};
+
+// Sum of products along the last statement index:
+// init + sum of lhs * rhs for last index in [1, size).
+// 'init' is evaluated with the last index equal to 0.
+class dot_product : public functional::expression
+{
+public:
+    dot_product(const location_type & l = location_type()):
+        expression(l) {}
+
+    functional::expr_ptr init;
+    std::shared_ptr<array_read> lhs;
+    std::shared_ptr<array_read> rhs;
+    int size = 0;
+};
+
 class model
 {
 public:
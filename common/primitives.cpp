@@ -92,6 +92,10 @@ string name_of_primitive( primitive_op op )
         return "||";
     case primitive_op::conditional:
         return "if";
+    case primitive_op::fft:
+        return "fft";
+    case primitive_op::ifft:
+        return "ifft";
     default:
         return "<unknown primitive op>";
     }
@@ -243,6 +247,14 @@ vector<prim_op_overload> overloads(primitive_op op)
             overloads.push_back(prim_op_overload({ pt::boolean, t, t, t }));
         break;
     }
+    case primitive_op::fft:
+    case primitive_op::ifft:
+        return {
+            { pt::real32, pt::complex32 },
+            { pt::real64, pt::complex64 },
+            { pt::complex32, pt::complex32 },
+            { pt::complex64, pt::complex64 }
+        };
     default:;
     }
 
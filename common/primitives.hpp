@@ -142,12 +142,22 @@ enum class primitive_op
 
     conditional,
 
+    fft,
+    ifft,
+
     // Total number of primitive_ops:
     //count
 };
 
 string name_of_primitive( primitive_op op );
 
+// Operations on entire arrays along their last dimension,
+// rather than elementwise.
+inline bool is_array_transform(primitive_op op)
+{
+    return op == primitive_op::fft || op == primitive_op::ifft;
+}
+
 struct prim_op_overload
 {
     prim_op_overload() {}
@@ -24,6 +24,7 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../polyhedral/scheduling.hpp"
 #include "../utility/debug.hpp"
 
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 #include <vector>
@@ -162,12 +163,20 @@ public:
 
     void parse()
     {
-        if (m_default_option)
-            m_default_option->process(*this);
-
         while(arg_count())
         {
-            parse_next_option();
+            if (m_default_option && current_arg()[0] != '-')
+            {
+                // Arguments not belonging to an option may be anywhere.
+                int count = arg_count();
+                m_default_option->process(*this);
+                if (arg_count() == count)
+                    throw error(string("Unexpected argument: ") + current_arg());
+            }
+            else
+            {
+                parse_next_option();
+            }
         }
     }
 
@@ -238,6 +247,20 @@ public:
         return false;
     }
 
+    // Parses the next argument only if it is one of 'choices',
+    // so that an optional argument is not confused with the input file.
+    bool try_parse_choice(string & arg, const vector<string> & choices)
+    {
+        if (arg_count() &&
+                std::find(choices.begin(), choices.end(), current_arg()) != choices.end())
+        {
+            arg = current_arg();
+            advance();
+            return true;
+        }
+        return false;
+    }
+
     void parse_option(string & opt)
     {
         if (arg_count() && current_arg()[0] == '-')
@@ -283,6 +306,25 @@ struct string_option : public option_parser
     void process(arguments & args) { args.parse_argument(*value, description); }
 };
 
+struct int_option : public option_parser
+{
+    int * value;
+    string description;
+
+    int_option(int * v, const string & d = string()):
+        value(v), description(d) {}
+    void process(arguments & args)
+    {
+        string text;
+        args.parse_argument(text, description);
+        try { *value = std::stoi(text); }
+        catch (std::exception &)
+        {
+            throw arguments::error("Expected an integer, got \"" + text + "\".");
+        }
+    }
+};
+
 struct string_list_option : public option_parser
 {
     vector<string> * values;
@@ -20,6 +20,7 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 
 #include "arg_parser.hpp"
 #include "compiler.hpp"
+#include "pass_timer.hpp"
 #include "../frontend/module_parser.hpp"
 #include "../common/ast_printer.hpp"
 #include "../common/func_model_printer.hpp"
@@ -29,11 +30,18 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../frontend/func_reducer.hpp"
 #include "../frontend/array_reduction.hpp"
 #include "../frontend/array_transpose.hpp"
+#include "../frontend/simplification.hpp"
+#include "../frontend/array_cse.hpp"
+#include "../frontend/array_inlining.hpp"
 #include "../frontend/type_check.hpp"
 #include "../frontend/ph_model_gen.hpp"
 #include "../polyhedral/scheduling.hpp"
 #include "../polyhedral/storage_alloc.hpp"
 #include "../polyhedral/modulo_avoidance.hpp"
+#include "../polyhedral/kernel_mapping.hpp"
+#include "../polyhedral/liveness.hpp"
+#include "../polyhedral/tabulation.hpp"
+#include "../polyhedral/rematerialization.hpp"
 #include "../polyhedral/isl_ast_gen.hpp"
 #include "../cpp/cpp_target.hpp"
 
@@ -92,13 +100,26 @@ result::code compile(const options & opts)
 result::code compile_module
 (const module_source & source, istream & text, const options & opts)
 {
+    pass_timer timer(opts.time_passes);
+
+    // Print timing on any return.
+    struct timing_report
+    {
+        const pass_timer & timer;
+        pass_timer::format format;
+        ~timing_report() { if (timer.enabled()) timer.print(cout, format); }
+    }
+    report { timer, opts.time_passes_format };
+
     module_parser parser;
     parser.set_import_dirs(opts.import_dirs);
 
     module * main_module;
 
     try {
+        timer.start("parsing");
         main_module = parser.parse(source, text);
+        timer.stop();
     } catch (stream::parser_error &) {
         return result::syntactic_error;
     } catch (io_error & e) {
@@ -111,8 +132,10 @@ result::code compile_module
         vector<functional::id_ptr> ids;
 
         {
+            timer.start("functional generation");
             functional::generator fgen;
             ids = fgen.generate(parser.modules());
+            timer.stop();
         }
 
         if (verbose<functional::model>::enabled())
@@ -144,9 +167,11 @@ result::code compile_module
         functional::name_provider func_name_provider(':');
 
         {
+            timer.start("function reduction");
             functional::func_reducer reducer(func_name_provider);
             id = reducer.reduce(id, {});
             array_ids = reducer.ids();
+            timer.stop();
 
             if (verbose<functional::model>::enabled())
             {
@@ -175,10 +200,12 @@ result::code compile_module
         }
 
         {
+            timer.start("array reduction");
             functional::array_reducer reducer(func_name_provider);
             id = reducer.process(id);
             array_ids = reducer.ids();
             array_ids.insert(id);
+            timer.stop();
 
             if (verbose<functional::model>::enabled())
             {
@@ -194,8 +221,10 @@ result::code compile_module
         }
 
         {
+            timer.start("array transposition");
             functional::array_transposer transposer;
             transposer.process(array_ids);
+            timer.stop();
             if (verbose<functional::model>::enabled())
             {
                 cout << "-- Transposed arrays:" << endl;
@@ -209,29 +238,167 @@ result::code compile_module
             }
         }
 
+        if (opts.simplify)
+        {
+            timer.start("simplification");
+            functional::simplifier simplifier(opts.relaxed_float);
+            simplifier.process(array_ids);
+            timer.stop();
+            if (verbose<functional::model>::enabled())
+            {
+                cout << "-- Simplified arrays:" << endl;
+                functional::printer printer;
+                printer.set_print_scopes(false);
+                for (const auto & id : array_ids)
+                {
+                    printer.print(id, cout);
+                    cout << endl;
+                }
+            }
+        }
+
+        {
+            timer.start("array cse");
+            functional::array_cse cse;
+            cse.process(array_ids, id);
+            timer.stop();
+        }
+
+        if (opts.inline_arrays)
+        {
+            timer.start("array inlining");
+            functional::array_inliner inliner;
+            inliner.process(array_ids, id);
+            timer.stop();
+            if (verbose<functional::model>::enabled())
+            {
+                cout << "-- Inlined arrays:" << endl;
+                functional::printer printer;
+                printer.set_print_scopes(false);
+                for (const auto & id : array_ids)
+                {
+                    printer.print(id, cout);
+                    cout << endl;
+                }
+            }
+        }
+
         {
             // Create polyhedral model
 
             polyhedral::model ph_model;
 
             {
+                timer.start("polyhedral model");
                 functional::polyhedral_gen gen;
                 ph_model = gen.process(array_ids);
                 gen.add_output(ph_model, "output", id);
+                timer.stop(ph_model);
             }
 
-            // Compute polyhedral schedule
+            if (opts.map_kernels)
+            {
+                timer.start("kernel mapping");
+                polyhedral::map_kernels(ph_model);
+                timer.stop(ph_model);
+            }
 
-            polyhedral::scheduler poly_scheduler( ph_model );
-            poly_scheduler.set_schedule_whole_program(opts.schedule_whole);
+            if (opts.eliminate_dead)
+            {
+                timer.start("dead elements");
+                polyhedral::eliminate_dead_elements(ph_model);
+                timer.stop(ph_model);
+            }
 
-            auto schedule = poly_scheduler.schedule(opts.optimize_schedule,
-                                                    opts.sched_reverse);
+            timer.start("tabulation");
+            polyhedral::tabulate_periodic_expressions(ph_model, opts.max_table_size);
+            timer.stop(ph_model);
 
-            // Allocate storage (buffers)
+            if (opts.hoist_invariants)
+            {
+                timer.start("hoisting");
+                polyhedral::hoist_invariant_expressions(ph_model);
+                timer.stop(ph_model);
+            }
+
+            auto schedule_and_allocate =
+                    [&](polyhedral::scheduler::fusion_strategy fusion)
+            {
+                // Compute polyhedral schedule
+
+                timer.start("scheduling");
+
+                polyhedral::scheduler poly_scheduler( ph_model );
+                poly_scheduler.set_schedule_whole_program(opts.schedule_whole);
+                poly_scheduler.set_fusion_strategy(fusion);
+                poly_scheduler.set_tiling(opts.tile, opts.tile_size);
+
+                auto schedule = poly_scheduler.schedule(opts.optimize_schedule,
+                                                        opts.sched_reverse);
+
+                timer.stop(ph_model, &schedule);
+
+                // Allocate storage (buffers)
+
+                timer.start("storage allocation");
+                polyhedral::storage_allocator storage_alloc( ph_model );
+                storage_alloc.allocate(schedule);
+                timer.stop();
+
+                return schedule;
+            };
+
+            auto fusion = opts.sched_fusion;
+
+            // Choose the fusion strategy which needs the least memory.
+            // On equal memory, the earlier strategy is kept.
+
+            if (opts.minimize_footprint)
+            {
+                using polyhedral::scheduler;
+
+                const char * fusion_names[] = { "default", "max", "min", "groups" };
+
+                int min_memory = -1;
+                for (auto candidate : { scheduler::default_fusion,
+                                        scheduler::group_fusion,
+                                        scheduler::max_fusion,
+                                        scheduler::min_fusion })
+                {
+                    schedule_and_allocate(candidate);
+                    int memory = polyhedral::buffer_memory(ph_model);
+
+                    if (verbose<polyhedral::storage_output>::enabled())
+                    {
+                        cout << "Buffer memory with fusion strategy "
+                             << fusion_names[candidate] << ": " << memory << endl;
+                    }
+
+                    if (min_memory < 0 || memory < min_memory)
+                    {
+                        min_memory = memory;
+                        fusion = candidate;
+                    }
+                }
+            }
 
-            polyhedral::storage_allocator storage_alloc( ph_model );
-            storage_alloc.allocate(schedule);
+            auto schedule = schedule_and_allocate(fusion);
+
+            // Trade storage for recomputation, one array at a time.
+
+            if (opts.memory_budget > 0)
+            {
+                for(;;)
+                {
+                    timer.start("rematerialization");
+                    bool changed =
+                            polyhedral::rematerialize_array(ph_model, opts.memory_budget);
+                    timer.stop(ph_model);
+                    if (!changed)
+                        break;
+                    schedule = schedule_and_allocate(fusion);
+                }
+            }
 
             // Print buffers
 
@@ -243,12 +410,16 @@ result::code compile_module
             // Modulo avoidance
 
             {
+                timer.start("modulo avoidance");
                 avoid_modulo(schedule, ph_model, opts.split_statements);
+                timer.stop(ph_model, &schedule);
             }
 
             // Generate AST for schedule
 
+            timer.start("ast generation");
             auto ast = polyhedral::make_isl_ast(schedule, opts.separate_loops);
+            timer.stop();
 
             if (verbose<polyhedral::ast_isl>::enabled())
             {
@@ -297,10 +468,85 @@ result::code compile_module
                 }
 #endif
 
+                auto kernel_info = cpp_gen::describe_kernel(ph_model, schedule);
+
+                {
+                    string info_filename = file_base + ".json";
+                    ofstream info_file(info_filename);
+                    if (!info_file.is_open())
+                    {
+                        cerr << "Could not open kernel description output file: "
+                             << info_filename << endl;
+                        return result::io_error;
+                    }
+                    cpp_gen::write_kernel_info(nmspace, kernel_info, info_file);
+                }
+
+                cpp_gen::generator_options gen_opts;
+                gen_opts.info = &kernel_info;
+                gen_opts.instrument = opts.cpp.instrument;
+                gen_opts.line_directives = opts.cpp.line_directives;
+                gen_opts.filename = cpp_filename;
+
+                timer.start("c++ generation");
                 cpp_gen::generate(nmspace,
                                   ph_model,
                                   ast,
-                                  cpp_file);
+                                  cpp_file,
+                                  gen_opts);
+                timer.stop();
+
+                // Generated files next to the kernel include it by this name.
+                string kernel_filename = cpp_filename;
+                auto sep_pos = kernel_filename.find_last_of("/\\");
+                if (sep_pos != string::npos)
+                    kernel_filename = kernel_filename.substr(sep_pos + 1);
+
+                if (opts.cpp.emit_bench)
+                {
+                    string bench_filename = file_base + "_bench.cpp";
+                    ofstream bench_file(bench_filename);
+                    if (!bench_file.is_open())
+                    {
+                        cerr << "Could not open C++ benchmark output file: "
+                             << bench_filename << endl;
+                        return result::io_error;
+                    }
+
+                    cpp_gen::generate_benchmark(nmspace, kernel_filename, ast,
+                                                bench_file, gen_opts);
+                }
+
+                if (opts.cpp.c_api)
+                {
+                    string c_header_filename = file_base + "_c.h";
+                    ofstream c_header_file(c_header_filename);
+                    if (!c_header_file.is_open())
+                    {
+                        cerr << "Could not open C header output file: "
+                             << c_header_filename << endl;
+                        return result::io_error;
+                    }
+
+                    string c_api_filename = file_base + "_c.cpp";
+                    ofstream c_api_file(c_api_filename);
+                    if (!c_api_file.is_open())
+                    {
+                        cerr << "Could not open C++ output file: "
+                             << c_api_filename << endl;
+                        return result::io_error;
+                    }
+
+                    string c_header_basename = kernel_filename;
+                    auto ext_pos = c_header_basename.rfind('.');
+                    if (ext_pos != string::npos)
+                        c_header_basename = c_header_basename.substr(0, ext_pos);
+                    c_header_basename += "_c.h";
+
+                    cpp_gen::generate_c_header(nmspace, kernel_info, c_header_file);
+                    cpp_gen::generate_c_api(nmspace, kernel_filename, c_header_basename,
+                                            kernel_info, c_api_file);
+                }
             }
         }
     }
@@ -28,13 +28,25 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../frontend/func_reducer.hpp"
 #include "../frontend/array_reduction.hpp"
 #include "../frontend/array_transpose.hpp"
+#include "../frontend/simplification.hpp"
+#include "../frontend/array_cse.hpp"
+#include "../frontend/array_inlining.hpp"
 #include "../frontend/ph_model_gen.hpp"
 #include "../polyhedral/modulo_avoidance.hpp"
+#include "../polyhedral/kernel_mapping.hpp"
+#include "../polyhedral/liveness.hpp"
+#include "../polyhedral/tabulation.hpp"
+#include "../polyhedral/rematerialization.hpp"
 #include "../polyhedral/scheduling.hpp"
 #include "../polyhedral/isl_ast_gen.hpp"
 #include "../polyhedral/storage_alloc.hpp"
 #include "../cpp/cpp_target.hpp"
 
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
 using namespace std;
 using namespace stream;
 using namespace stream::compiler;
@@ -76,6 +88,49 @@ private:
     unordered_map<string,bool*> m_topics;
 };
 
+// Replaces each "--options-file <file>" with the options in the file,
+// separated by whitespace. Lines starting with '#' are ignored.
+bool expand_options_files(int argc, char *argv[], vector<string> & expanded)
+{
+    for (int i = 0; i < argc; ++i)
+    {
+        string arg(argv[i]);
+        if (arg != "--options-file")
+        {
+            expanded.push_back(arg);
+            continue;
+        }
+
+        if (i + 1 >= argc)
+        {
+            cerr << arguments::missing_argument("file", arg).msg() << endl;
+            return false;
+        }
+
+        string filename(argv[++i]);
+        ifstream file(filename);
+        if (!file.is_open())
+        {
+            cerr << "streamc: error: Failed to open options file: '"
+                 << filename << "'." << endl;
+            return false;
+        }
+
+        string line;
+        while(getline(file, line))
+        {
+            if (!line.empty() && line[0] == '#')
+                continue;
+            istringstream words(line);
+            string word;
+            while(words >> word)
+                expanded.push_back(word);
+        }
+    }
+
+    return true;
+}
+
 }
 }
 
@@ -83,10 +138,23 @@ int main(int argc, char *argv[])
 {
     options opt;
 
-    arguments args(argc-1, argv+1);
+    vector<string> expanded_args;
+    if (!expand_options_files(argc-1, argv+1, expanded_args))
+        return result::command_line_error;
+
+    vector<char*> arg_ptrs;
+    for (auto & arg : expanded_args)
+        arg_ptrs.push_back(&arg[0]);
+
+    arguments args(arg_ptrs.size(), arg_ptrs.data());
 
     args.set_default_option({"", "", "<input filename>", ""}, [&opt](arguments& args){
-        args.try_parse_argument(opt.input_filename);
+        string filename;
+        if (!args.try_parse_argument(filename))
+            return;
+        if (!opt.input_filename.empty())
+            throw arguments::error("Unexpected argument: " + filename);
+        opt.input_filename = filename;
     });
 
     args.add_option({"help", "h", "Print help."}, [](arguments& args){
@@ -97,6 +165,12 @@ int main(int argc, char *argv[])
     args.add_option({"import", "i", "<dir>", "Import directory <dir>."},
                     new string_list_option(&opt.import_dirs));
 
+    args.add_option({"options-file", "", "<file>",
+                     "Read further options from <file>, e.g. as stored by arrp-tune."},
+                    [](arguments &){
+        // Expanded before parsing.
+    });
+
     args.add_option({"cpp", "", "<name>", "Generate C++ output file named <name>.cpp"},
                     [&opt](arguments& args){
         opt.cpp.enabled = true;
@@ -106,12 +180,111 @@ int main(int argc, char *argv[])
     args.add_option({"cpp-namespace", "", "<name>", "Generate C++ output in namespace <name>."},
                     new string_option(&opt.cpp.nmspace));
 
+    args.add_option({"emit-bench", "", "",
+                     "Also generate a benchmark program named <name>_bench.cpp,"
+                     " where <name> is given by --cpp."},
+                    [&opt](arguments &){
+        opt.cpp.enabled = true;
+        opt.cpp.emit_bench = true;
+    });
+
+    args.add_option({"c-api", "", "",
+                     "Also generate C functions which drive the kernel"
+                     " in files named <name>_c.cpp and <name>_c.h."
+                     " See arrp/kernel.h."},
+                    [&opt](arguments &){
+        opt.cpp.enabled = true;
+        opt.cpp.c_api = true;
+    });
+
+    args.add_option({"instrument", "", "",
+                     "Instrument generated C++ code to count statement iterations"
+                     " and time loop nests. See arrp/profile.hpp."},
+                    new switch_option(&opt.cpp.instrument));
+
+    args.add_option({"line-directives", "", "",
+                     "Emit #line directives in generated C++ code, so that"
+                     " debuggers and profilers refer to Arrp source lines."},
+                    new switch_option(&opt.cpp.line_directives));
+
     args.add_option({"sched-no-opt", "", "", "Disable schedule optimization."},
                     new switch_option(&opt.optimize_schedule, false));
     args.add_option({"sched-whole", "", "", "Schedule whole program at once."},
                     new switch_option(&opt.schedule_whole));
+    args.add_option({"sched-fusion", "", "<strategy>",
+                     "Statement fusion strategy: max, min or groups."
+                     " By default, isl decides."},
+                    [&opt](arguments & args){
+        string strategy;
+        if (!args.try_parse_argument(strategy))
+            throw arguments::missing_argument("strategy", "sched-fusion");
+        if (strategy == "max")
+            opt.sched_fusion = polyhedral::scheduler::max_fusion;
+        else if (strategy == "min")
+            opt.sched_fusion = polyhedral::scheduler::min_fusion;
+        else if (strategy == "groups")
+            opt.sched_fusion = polyhedral::scheduler::group_fusion;
+        else
+            throw arguments::error("Unknown fusion strategy: " + strategy);
+    });
+    args.add_option({"sched-objective", "", "<objective>",
+                     "Schedule objective: throughput (default) or footprint."
+                     " Footprint chooses among fusion strategies the one"
+                     " which allocates the least buffer memory."},
+                    [&opt](arguments & args){
+        string objective;
+        if (!args.try_parse_argument(objective))
+            throw arguments::missing_argument("objective", "sched-objective");
+        if (objective == "throughput")
+            opt.minimize_footprint = false;
+        else if (objective == "footprint")
+            opt.minimize_footprint = true;
+        else
+            throw arguments::error("Unknown schedule objective: " + objective);
+    });
+    args.add_option({"tile", "", "",
+                     "Tile permutable loop bands over finite dimensions."},
+                    new switch_option(&opt.tile));
+    args.add_option({"tile-size", "", "<n>",
+                     "Tile size used with --tile."
+                     " Default: derived from the L1 cache size."},
+                    new int_option(&opt.tile_size, "tile size"));
     args.add_option({"ast-avoid-branch-in-loop", "", "", "Split loops to avoid branching inside."},
                     new switch_option(&opt.separate_loops));
+    args.add_option({"no-simplify", "", "", "Do not simplify arithmetic expressions."},
+                    new switch_option(&opt.simplify, false));
+    args.add_option({"relaxed-float", "", "", "Allow simplifications which may change"
+                     " floating-point results in the last bits."},
+                    new switch_option(&opt.relaxed_float));
+    args.add_option({"no-inline", "", "", "Do not inline cheap arrays into the arrays which read them."},
+                    new switch_option(&opt.inline_arrays, false));
+    args.add_option({"kernels", "", "", "Compute dot products using library kernels."
+                     " Floating-point sums may be reordered."},
+                    new switch_option(&opt.map_kernels));
+    args.add_option({"no-dead-elim", "", "", "Compute all array elements, including those which are never used."},
+                    new switch_option(&opt.eliminate_dead, false));
+    args.add_option({"max-table-size", "", "<n>",
+                     "Tabulate periodic expressions in tables of at most <n> elements."
+                     " 0 disables tabulation. Default: 1024."},
+                    new int_option(&opt.max_table_size, "table size"));
+    args.add_option({"hoist", "", "", "Compute constant expressions once, before the streaming loop."
+                     " Only useful with --no-simplify, which leaves such expressions unfolded."},
+                    new switch_option(&opt.hoist_invariants));
+    args.add_option({"memory-budget", "", "<bytes>",
+                     "Recompute cheap streams instead of storing them"
+                     " while buffers exceed <bytes>. Default: 0 (no limit)."},
+                    new int_option(&opt.memory_budget, "memory budget"));
+    args.add_option({"time-passes", "", "[<format>]",
+                     "Print time, memory and isl object counts for each compiler pass."
+                     " Format: table (default) or json."},
+                    [&opt](arguments & args){
+        opt.time_passes = true;
+        string format;
+        if (args.try_parse_choice(format, {"table", "json"}) && format == "json")
+            opt.time_passes_format = pass_timer::json_format;
+        else
+            opt.time_passes_format = pass_timer::table_format;
+    });
 
     auto verbose_out = new verbose_out_options;
     verbose_out->add_topic<module_parser>("parsing");
@@ -122,8 +295,16 @@ int main(int argc, char *argv[])
     verbose_out->add_topic<functional::func_reducer>("func-reduction");
     verbose_out->add_topic<functional::array_reducer>("array-reduction");
     verbose_out->add_topic<functional::array_transposer>("array-transpose");
+    verbose_out->add_topic<functional::simplifier>("simplification");
+    verbose_out->add_topic<functional::array_cse>("array-cse");
+    verbose_out->add_topic<functional::array_inliner>("array-inlining");
     verbose_out->add_topic<functional::polyhedral_gen>("ph-model-gen");
     verbose_out->add_topic<polyhedral::model>("ph-model");
+    verbose_out->add_topic<polyhedral::kernel_mapping>("kernels");
+    verbose_out->add_topic<polyhedral::liveness>("liveness");
+    verbose_out->add_topic<polyhedral::tabulation>("tabulation");
+    verbose_out->add_topic<polyhedral::invariant_hoisting>("hoisting");
+    verbose_out->add_topic<polyhedral::rematerialization>("rematerialization");
     verbose_out->add_topic<polyhedral::modulo_avoidance>("mod-avoid");
     verbose_out->add_topic<polyhedral::scheduler>("ph-scheduling");
     verbose_out->add_topic<polyhedral::ast_isl>("ph-ast");
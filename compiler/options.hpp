@@ -21,6 +21,7 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #ifndef ARRP_COMPILER_OPTIONS
 #define ARRP_COMPILER_OPTIONS
 
+#include "pass_timer.hpp"
 #include "../polyhedral/scheduling.hpp"
 
 namespace stream {
@@ -36,14 +37,33 @@ struct options
         bool enabled;
         string nmspace;
         string filename;
+        bool emit_bench = false;
+        bool c_api = false;
+        bool instrument = false;
+        bool line_directives = false;
     } cpp;
 
     vector<string> import_dirs;
     vector<polyhedral::scheduler::reversal> sched_reverse;
     bool optimize_schedule = true;
     bool schedule_whole = false;
+    polyhedral::scheduler::fusion_strategy sched_fusion =
+            polyhedral::scheduler::default_fusion;
+    bool minimize_footprint = false;
+    bool tile = false;
+    int tile_size = 0;
     bool split_statements = false;
     bool separate_loops = false;
+    bool simplify = true;
+    bool relaxed_float = false;
+    bool inline_arrays = true;
+    bool map_kernels = false;
+    bool eliminate_dead = true;
+    int max_table_size = 1024;
+    bool hoist_invariants = false;
+    int memory_budget = 0;
+    bool time_passes = false;
+    pass_timer::format time_passes_format = pass_timer::table_format;
 };
 
 }
@@ -0,0 +1,254 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "pass_timer.hpp"
+
+#include <isl/set.h>
+#include <isl/map.h>
+
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace stream {
+namespace compiler {
+
+namespace {
+
+int basic_set_count(const isl::set & s)
+{
+    if (!s.get())
+        return 0;
+    return isl_set_n_basic_set(s.get());
+}
+
+int basic_map_count(const isl::map & m)
+{
+    if (!m.get())
+        return 0;
+    return isl_map_n_basic_map(m.get());
+}
+
+int basic_map_count(const isl::union_map & um)
+{
+    int count = 0;
+    um.for_each([&](const isl::map & m){
+        count += basic_map_count(m);
+        return true;
+    });
+    return count;
+}
+
+}
+
+pass_timer::sample pass_timer::now()
+{
+    sample s;
+
+    auto wall = chrono::steady_clock::now().time_since_epoch();
+    s.wall_ms = chrono::duration<double, milli>(wall).count();
+
+#ifndef _WIN32
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    s.cpu_ms = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+            (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+    // Kilobytes on Linux, bytes on macOS.
+#ifdef __APPLE__
+    s.peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    s.peak_rss_kb = usage.ru_maxrss;
+#endif
+#else
+    s.cpu_ms = std::clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+
+    return s;
+}
+
+pass_timer::record & pass_timer::record_for(const string & name)
+{
+    for (auto & r : m_records)
+    {
+        if (r.name == name)
+            return r;
+    }
+
+    m_records.emplace_back();
+    m_records.back().name = name;
+    return m_records.back();
+}
+
+void pass_timer::start(const string & pass)
+{
+    if (!m_enabled)
+        return;
+
+    m_current = pass;
+    m_start = now();
+}
+
+void pass_timer::stop()
+{
+    if (!m_enabled || m_current.empty())
+        return;
+
+    auto end = now();
+
+    auto & r = record_for(m_current);
+    ++r.runs;
+    r.wall_ms += end.wall_ms - m_start.wall_ms;
+    r.cpu_ms += end.cpu_ms - m_start.cpu_ms;
+    r.rss_growth_kb += end.peak_rss_kb - m_start.peak_rss_kb;
+
+    m_current.clear();
+}
+
+void pass_timer::stop(const polyhedral::model & model,
+                      const polyhedral::schedule * schedule)
+{
+    if (!m_enabled || m_current.empty())
+        return;
+
+    auto name = m_current;
+
+    stop();
+
+    // Counted after the timing, so counting is not measured.
+
+    int basic_sets = 0;
+    int basic_maps = 0;
+
+    for (auto & array : model.arrays)
+        basic_sets += basic_set_count(array->domain);
+
+    for (auto & stmt : model.statements)
+    {
+        basic_sets += basic_set_count(stmt->domain);
+        if (stmt->write_relation.array)
+            basic_maps += basic_map_count(to_isl_map(stmt, stmt->write_relation));
+        for (auto & rel : stmt->read_relations)
+            basic_maps += basic_map_count(to_isl_map(stmt, rel));
+    }
+
+    if (schedule)
+    {
+        basic_maps += basic_map_count(schedule->full);
+        basic_maps += basic_map_count(schedule->tiled);
+    }
+
+    auto & r = record_for(name);
+    r.basic_sets = basic_sets;
+    r.basic_maps = basic_maps;
+}
+
+void pass_timer::print(ostream & out, format f) const
+{
+    if (f == json_format)
+        print_json(out);
+    else
+        print_table(out);
+}
+
+void pass_timer::print_table(ostream & out) const
+{
+    auto count_text = [](int count) {
+        return count < 0 ? string("-") : to_string(count);
+    };
+
+    out << endl << "== Pass timing ==" << endl;
+    out << left << setw(24) << "Pass"
+        << right
+        << setw(6) << "Runs"
+        << setw(12) << "Wall [ms]"
+        << setw(12) << "CPU [ms]"
+        << setw(14) << "Peak RSS +KB"
+        << setw(12) << "Basic sets"
+        << setw(12) << "Basic maps"
+        << endl;
+
+    double total_wall = 0, total_cpu = 0;
+    long total_rss = 0;
+
+    auto flags = out.flags();
+    auto precision = out.precision();
+
+    out << fixed << setprecision(2);
+
+    for (auto & r : m_records)
+    {
+        out << left << setw(24) << r.name
+            << right
+            << setw(6) << r.runs
+            << setw(12) << r.wall_ms
+            << setw(12) << r.cpu_ms
+            << setw(14) << r.rss_growth_kb
+            << setw(12) << count_text(r.basic_sets)
+            << setw(12) << count_text(r.basic_maps)
+            << endl;
+
+        total_wall += r.wall_ms;
+        total_cpu += r.cpu_ms;
+        total_rss += r.rss_growth_kb;
+    }
+
+    out << left << setw(24) << "Total"
+        << right
+        << setw(6) << ""
+        << setw(12) << total_wall
+        << setw(12) << total_cpu
+        << setw(14) << total_rss
+        << endl;
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void pass_timer::print_json(ostream & out) const
+{
+    out << "{\"passes\": [";
+    for (int i = 0; i < (int) m_records.size(); ++i)
+    {
+        auto & r = m_records[i];
+        if (i > 0)
+            out << ",";
+        out << endl << "  {"
+            << "\"name\": \"" << r.name << "\", "
+            << "\"runs\": " << r.runs << ", "
+            << "\"wall_ms\": " << r.wall_ms << ", "
+            << "\"cpu_ms\": " << r.cpu_ms << ", "
+            << "\"peak_rss_growth_kb\": " << r.rss_growth_kb;
+        if (r.basic_sets >= 0)
+            out << ", \"basic_sets\": " << r.basic_sets;
+        if (r.basic_maps >= 0)
+            out << ", \"basic_maps\": " << r.basic_maps;
+        out << "}";
+    }
+    out << endl << "]}" << endl;
+}
+
+}
+}
@@ -0,0 +1,95 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_COMPILER_PASS_TIMER_INCLUDED
+#define ARRP_COMPILER_PASS_TIMER_INCLUDED
+
+#include "../common/ph_model.hpp"
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace stream {
+namespace compiler {
+
+using std::string;
+using std::vector;
+using std::ostream;
+
+/*
+Measures compiler passes: wall and CPU time, growth of peak
+resident memory, and the number of isl basic sets and basic maps
+in the polyhedral model after each pass.
+
+Repeated runs of a pass with the same name are accumulated.
+*/
+
+class pass_timer
+{
+public:
+    enum format { table_format, json_format };
+
+    pass_timer(bool enabled = false): m_enabled(enabled) {}
+
+    bool enabled() const { return m_enabled; }
+
+    void start(const string & pass);
+    void stop();
+    // Also counts isl objects in the model and the schedule (if any).
+    void stop(const polyhedral::model &,
+              const polyhedral::schedule * = nullptr);
+
+    void print(ostream &, format) const;
+
+private:
+    struct sample
+    {
+        double wall_ms = 0;
+        double cpu_ms = 0;
+        long peak_rss_kb = 0;
+    };
+
+    struct record
+    {
+        string name;
+        int runs = 0;
+        double wall_ms = 0;
+        double cpu_ms = 0;
+        long rss_growth_kb = 0;
+        int basic_sets = -1;
+        int basic_maps = -1;
+    };
+
+    static sample now();
+    record & record_for(const string & name);
+    void print_table(ostream &) const;
+    void print_json(ostream &) const;
+
+    bool m_enabled;
+    string m_current;
+    sample m_start;
+    vector<record> m_records;
+};
+
+}
+}
+
+#endif // ARRP_COMPILER_PASS_TIMER_INCLUDED
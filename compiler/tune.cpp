@@ -0,0 +1,350 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "options.hpp"
+#include "arg_parser.hpp"
+#include "compiler.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <sys/stat.h>
+
+using namespace std;
+using namespace stream;
+using namespace stream::compiler;
+
+#ifndef ARRP_RUNTIME_INCLUDE_DIR
+#define ARRP_RUNTIME_INCLUDE_DIR ""
+#endif
+
+namespace {
+
+struct tune_options
+{
+    options compiler;
+    string work_dir = "arrp-tune";
+    string output_filename;
+    string runtime_include_dir = ARRP_RUNTIME_INCLUDE_DIR;
+    int periods = 10000;
+    int repetitions = 5;
+};
+
+// Compiler options together with their command line form.
+struct variant
+{
+    options opts;
+    vector<string> args;
+};
+
+vector<variant> enumerate_variants(const options & base)
+{
+    using polyhedral::scheduler;
+
+    vector<variant> variants;
+
+    struct fusion_choice { scheduler::fusion_strategy strategy; const char * name; };
+    vector<fusion_choice> fusions = {
+        { scheduler::default_fusion, nullptr },
+        { scheduler::group_fusion, "groups" },
+        { scheduler::max_fusion, "max" },
+        { scheduler::min_fusion, "min" }
+    };
+
+    for (bool optimize : { true, false })
+    for (bool whole : { false, true })
+    for (bool separate : { false, true })
+    for (auto & fusion : fusions)
+    for (bool tile : { false, true })
+    {
+        // Without schedule optimization, fusion and tiling have no effect.
+        if (!optimize && (fusion.name || tile))
+            continue;
+
+        variant v;
+        v.opts = base;
+        v.opts.optimize_schedule = optimize;
+        v.opts.schedule_whole = whole;
+        v.opts.separate_loops = separate;
+        v.opts.sched_fusion = fusion.strategy;
+        v.opts.tile = tile;
+
+        if (!optimize)
+            v.args.push_back("--sched-no-opt");
+        if (whole)
+            v.args.push_back("--sched-whole");
+        if (separate)
+            v.args.push_back("--ast-avoid-branch-in-loop");
+        if (fusion.name)
+        {
+            v.args.push_back("--sched-fusion");
+            v.args.push_back(fusion.name);
+        }
+        if (tile)
+            v.args.push_back("--tile");
+
+        variants.push_back(v);
+    }
+
+    return variants;
+}
+
+string join(const vector<string> & args)
+{
+    ostringstream text;
+    for (int i = 0; i < (int) args.size(); ++i)
+    {
+        if (i > 0)
+            text << ' ';
+        text << args[i];
+    }
+    return text.str();
+}
+
+// Quotes an argument for the POSIX shell.
+string shell_quote(const string & arg)
+{
+    string quoted = "'";
+    for (char c : arg)
+    {
+        if (c == '\'')
+            quoted += "'\\''";
+        else
+            quoted += c;
+    }
+    quoted += "'";
+    return quoted;
+}
+
+string env_or(const char * name, const string & fallback)
+{
+    const char * value = std::getenv(name);
+    return value ? string(value) : fallback;
+}
+
+// Returns the run time in nanoseconds, or a negative value on failure.
+double measure(const variant & v, const tune_options & tune, int index)
+{
+    string dir = tune.work_dir + "/variant" + to_string(index);
+    mkdir(dir.c_str(), 0755);
+
+    auto opts = v.opts;
+    opts.cpp.enabled = true;
+    opts.cpp.filename = dir + "/kernel";
+    opts.cpp.nmspace = "kernel";
+    opts.cpp.emit_bench = true;
+
+    try
+    {
+        if (compile(opts) != result::ok)
+            return -1;
+    }
+    catch (std::exception & e)
+    {
+        cerr << "  " << e.what() << endl;
+        return -1;
+    }
+
+    string exe = dir + "/kernel_bench";
+
+    // Compiler and flags from the environment may consist of several words,
+    // so only paths are quoted.
+    ostringstream build;
+    build << env_or("CXX", "c++")
+          << " -std=c++11 " << env_or("CXXFLAGS", "-O3");
+    if (!tune.runtime_include_dir.empty())
+        build << " -I " << shell_quote(tune.runtime_include_dir);
+    build << " -o " << shell_quote(exe) << ' ' << shell_quote(exe + ".cpp") << ' '
+          << env_or("LDFLAGS", "")
+          << " > " << shell_quote(dir + "/build.log") << " 2>&1";
+
+    if (std::system(build.str().c_str()) != 0)
+    {
+        cerr << "  C++ compilation failed. See " << dir << "/build.log" << endl;
+        return -1;
+    }
+
+    // The benchmark reports the shortest time of 'initialize'
+    // followed by the given number of periods.
+
+    ostringstream run;
+    run << shell_quote(exe) << " --periods " << tune.periods
+        << " --repeat " << tune.repetitions << " --json";
+
+    FILE * output = popen(run.str().c_str(), "r");
+    if (!output)
+        return -1;
+
+    string report;
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), output))
+        report += buffer;
+
+    if (pclose(output) != 0)
+        return -1;
+
+    const string key = "\"best_run_ns\": ";
+    auto pos = report.find(key);
+    if (pos == string::npos)
+        return -1;
+
+    return std::atof(report.c_str() + pos + key.size());
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    tune_options tune;
+    tune.compiler.cpp.enabled = false;
+
+    arguments args(argc-1, argv+1);
+
+    args.set_default_option({"", "", "<input filename>", ""}, [&tune](arguments& args){
+        string filename;
+        if (!args.try_parse_argument(filename))
+            return;
+        if (!tune.compiler.input_filename.empty())
+            throw arguments::error("Unexpected argument: " + filename);
+        tune.compiler.input_filename = filename;
+    });
+
+    args.add_option({"help", "h", "Print help."}, [](arguments& args){
+        cout << "Compiles the input with different options, benchmarks" << endl
+             << "the generated C++ code and stores the fastest options" << endl
+             << "in a file to be passed to arrp with --options-file." << endl
+             << "Generated code is compiled using $CXX $CXXFLAGS ... $LDFLAGS." << endl;
+        args.print_help();
+        throw arguments::abortion();
+    });
+
+    args.add_option({"import", "i", "<dir>", "Import directory <dir>."},
+                    new string_list_option(&tune.compiler.import_dirs));
+
+    args.add_option({"output", "o", "<file>",
+                     "Store the fastest options in <file>. Default: <input>.options"},
+                    new string_option(&tune.output_filename, "file"));
+
+    args.add_option({"work-dir", "", "<dir>",
+                     "Directory for generated variants. Default: arrp-tune"},
+                    new string_option(&tune.work_dir, "dir"));
+
+    args.add_option({"runtime-include", "", "<dir>",
+                     "Directory with arrp runtime headers."},
+                    new string_option(&tune.runtime_include_dir, "dir"));
+
+    args.add_option({"periods", "", "<n>",
+                     "Number of periods per measurement. Default: 10000"},
+                    new int_option(&tune.periods, "periods"));
+
+    args.add_option({"repeat", "", "<n>",
+                     "Number of measurements per variant. Default: 5"},
+                    new int_option(&tune.repetitions, "repetitions"));
+
+    try {
+        args.parse();
+    }
+    catch (arguments::abortion &)
+    {
+        return result::ok;
+    }
+    catch (arguments::error & e)
+    {
+        cerr << e.msg() << endl;
+        return result::command_line_error;
+    }
+
+    if (tune.compiler.input_filename.empty())
+    {
+        cerr << "arrp-tune: error: Missing input filename." << endl;
+        return result::command_line_error;
+    }
+
+    if (tune.output_filename.empty())
+    {
+        auto & input = tune.compiler.input_filename;
+        auto dot_pos = input.rfind('.');
+        auto sep_pos = input.find_last_of("/\\");
+        if (dot_pos != string::npos && (sep_pos == string::npos || dot_pos > sep_pos))
+            tune.output_filename = input.substr(0, dot_pos) + ".options";
+        else
+            tune.output_filename = input + ".options";
+    }
+
+    mkdir(tune.work_dir.c_str(), 0755);
+
+    auto variants = enumerate_variants(tune.compiler);
+
+    int best_index = -1;
+    double best_ns = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < (int) variants.size(); ++i)
+    {
+        auto & v = variants[i];
+
+        cout << "[" << (i+1) << "/" << variants.size() << "] "
+             << (v.args.empty() ? string("(defaults)") : join(v.args)) << endl;
+
+        double ns = measure(v, tune, i);
+        if (ns < 0)
+        {
+            cout << "  failed" << endl;
+            continue;
+        }
+
+        cout << "  " << ns / 1e6 << " ms" << endl;
+
+        if (ns < best_ns)
+        {
+            best_ns = ns;
+            best_index = i;
+        }
+    }
+
+    if (best_index < 0)
+    {
+        cerr << "arrp-tune: error: No variant could be measured." << endl;
+        return result::generator_error;
+    }
+
+    auto & best = variants[best_index];
+
+    ofstream file(tune.output_filename);
+    if (!file.is_open())
+    {
+        cerr << "arrp-tune: error: Could not open output file: "
+             << tune.output_filename << endl;
+        return result::io_error;
+    }
+
+    file << "# Generated by arrp-tune for " << tune.compiler.input_filename << endl;
+    file << "# " << best_ns / 1e6 << " ms for " << tune.periods << " periods" << endl;
+    for (auto & arg : best.args)
+        file << arg << endl;
+
+    cout << "Fastest: "
+         << (best.args.empty() ? string("(defaults)") : join(best.args)) << endl;
+    cout << "Stored in " << tune.output_filename << endl;
+
+    return result::ok;
+}
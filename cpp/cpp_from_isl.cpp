@@ -38,6 +38,7 @@ cpp_from_isl::cpp_from_isl(builder *ctx):
 void cpp_from_isl::generate( isl_ast_node * ast )
 {
     m_is_user_stmt = false;
+    m_loop_depth = 0;
     process_node(ast);
 }
 
@@ -159,6 +160,10 @@ void cpp_from_isl::process_for(isl_ast_node *node)
     auto iter_decl = decl_expr(make_shared<basic_type>("int"),
                                *iter_id, init);
 
+    bool is_nest = m_loop_depth == 0 && m_nest_func;
+    if (is_nest)
+        m_nest_func(true, m_ctx);
+
     auto for_stmt = make_shared<for_statement>();
 
     for_stmt->initialization = iter_decl;
@@ -171,7 +176,9 @@ void cpp_from_isl::process_for(isl_ast_node *node)
         vector<statement_ptr> stmts;
 
         m_ctx->push(&stmts);
+        ++m_loop_depth;
         process_node(body_node);
+        --m_loop_depth;
         m_ctx->pop();
 
         if (stmts.size() == 1)
@@ -182,6 +189,9 @@ void cpp_from_isl::process_for(isl_ast_node *node)
 
     m_ctx->add(for_stmt);
 
+    if (is_nest)
+        m_nest_func(false, m_ctx);
+
     isl_ast_expr_free(iter_expr);
     isl_ast_expr_free(init_expr);
     isl_ast_expr_free(cond_expr);
@@ -193,6 +203,10 @@ void cpp_from_isl::process_user(isl_ast_node *node)
 {
     auto ast_expr = isl_ast_node_user_get_expr(node);
 
+    bool is_nest = m_loop_depth == 0 && m_nest_func;
+    if (is_nest)
+        m_nest_func(true, m_ctx);
+
     m_is_user_stmt = true;
     auto expr = process_expr(ast_expr);
     m_is_user_stmt = false;
@@ -200,6 +214,9 @@ void cpp_from_isl::process_user(isl_ast_node *node)
     if (expr)
         m_ctx->add(expr);
 
+    if (is_nest)
+        m_nest_func(false, m_ctx);
+
     isl_ast_expr_free(ast_expr);
 }
 
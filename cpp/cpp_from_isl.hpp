@@ -48,6 +48,14 @@ public:
         m_id_func = f;
     }
 
+    // Called before (true) and after (false) generating
+    // each outermost loop nest or statement outside of loops.
+    template<typename F>
+    void set_nest_func(F f)
+    {
+        m_nest_func = f;
+    }
+
 private:
     void process_node(isl_ast_node *node);
     void process_block(isl_ast_node *node);
@@ -66,6 +74,11 @@ private:
     std::function<expression_ptr(const string &)>
     m_id_func;
 
+    std::function<void(bool, builder *)>
+    m_nest_func;
+
+    int m_loop_depth = 0;
+
     bool m_is_user_stmt = false;
     builder *m_ctx;
 };
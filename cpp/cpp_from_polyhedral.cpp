@@ -1,6 +1,13 @@
 #include "cpp_from_polyhedral.hpp"
 #include "../common/error.hpp"
 
+#include <isl/map.h>
+#include <isl/set.h>
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
 using namespace std;
 
 namespace stream {
@@ -87,10 +94,18 @@ void cpp_from_polyhedral::generate_statement
 {
     m_current_stmt = stmt;
 
+    if (auto transform = dynamic_cast<polyhedral::transform_call*>(stmt->expr.get()))
+    {
+        generate_transform(stmt, transform, index, ctx);
+        return;
+    }
+
     expression_ptr expr;
 
     {
+        start_value_numbering(stmt->expr);
         expr = generate_expression(stmt->expr, index, ctx);
+        end_value_numbering();
 
         if (stmt->write_relation.array)
         {
@@ -107,6 +122,317 @@ void cpp_from_polyhedral::generate_statement
     }
 }
 
+void cpp_from_polyhedral::generate_transform
+(polyhedral::statement * stmt, polyhedral::transform_call * transform,
+ const index_type & index, builder * ctx)
+{
+    auto out_array = stmt->write_relation.array;
+    assert(out_array);
+
+    // Leading indexes select the row, the transformed dimension starts at 0.
+
+    int row_dims = (int) out_array->size.size() - 1;
+    index_type row_index(index.begin(), index.begin() + row_dims);
+    row_index.push_back(literal((int)0));
+
+    auto src = unop(op::address, generate_buffer_access(transform->input, row_index, ctx));
+    auto dst = unop(op::address, generate_buffer_access(out_array, row_index, ctx));
+
+    string method;
+    switch(transform->kind)
+    {
+    case primitive_op::fft:
+        method = "forward"; break;
+    case primitive_op::ifft:
+        method = "inverse"; break;
+    default:
+        throw error("Unexpected array transform.");
+    }
+
+    auto plan = make_id(fft_plan_name(transform->size, out_array->type));
+    auto callee = binop(op::member_of_reference, plan, make_id(method));
+    ctx->add(call(callee, {src, dst}));
+}
+
+// Coefficient of an iterator in an affine index expression.
+// Returns false if the expression is not affine in the iterator.
+static bool iterator_coefficient(const functional::expr_ptr & expr, int iterator, int & coef)
+{
+    if (auto it = dynamic_cast<polyhedral::iterator_read*>(expr.get()))
+    {
+        coef = it->index == iterator ? 1 : 0;
+        return true;
+    }
+    else if (dynamic_cast<functional::int_const*>(expr.get()))
+    {
+        coef = 0;
+        return true;
+    }
+    else if (auto op = dynamic_cast<functional::primitive*>(expr.get()))
+    {
+        vector<int> coefs;
+        for (auto & operand : op->operands)
+        {
+            int c;
+            if (!iterator_coefficient(operand, iterator, c))
+                return false;
+            coefs.push_back(c);
+        }
+
+        switch(op->kind)
+        {
+        case primitive_op::add:
+            coef = coefs[0] + coefs[1];
+            return true;
+        case primitive_op::subtract:
+            coef = coefs[0] - coefs[1];
+            return true;
+        case primitive_op::negate:
+            coef = -coefs[0];
+            return true;
+        case primitive_op::multiply:
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                auto c = dynamic_cast<functional::int_const*>(op->operands[k].expr.get());
+                if (c)
+                {
+                    coef = c->value * coefs[1-k];
+                    return true;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        // Other operations are fine as long as they don't involve the iterator.
+        coef = 0;
+        return std::all_of(coefs.begin(), coefs.end(), [](int c){ return c == 0; });
+    }
+
+    return false;
+}
+
+// Can the elements read along the iterator be addressed
+// by a pointer with a constant stride?
+bool cpp_from_polyhedral::has_linear_layout
+(polyhedral::array_read * read, int iterator, int & stride)
+{
+    auto & array = read->array;
+
+    int dim = -1;
+    for (int d = 0; d < (int) read->indexes.size(); ++d)
+    {
+        int coef;
+        if (!iterator_coefficient(read->indexes[d], iterator, coef))
+            return false;
+        if (coef == 0)
+            continue;
+        if (coef != 1 || dim >= 0)
+            return false;
+        dim = d;
+    }
+
+    stride = 0;
+
+    if (dim < 0)
+        return true;
+
+    if (array->buffer_size[dim] < 2)
+        return false;
+
+    if (array->is_infinite && dim == 0)
+    {
+        if (m_current_stmt->streaming_needs_modulo)
+            return false;
+    }
+    else if (array->buffer_size[dim] < array->size[dim])
+    {
+        return false;
+    }
+
+    stride = 1;
+    for (int d = dim + 1; d < (int) array->buffer_size.size(); ++d)
+        stride *= array->buffer_size[d];
+
+    return true;
+}
+
+expression_ptr cpp_from_polyhedral::generate_dot_product
+(polyhedral::dot_product * dot, const index_type & index, builder * ctx)
+{
+    assert(!index.empty());
+    int last = (int) index.size() - 1;
+
+    auto type = type_for(prim_type(dot));
+
+    string acc_id;
+    ctx->add(make_shared<expr_statement>(ctx->new_var(type, acc_id)));
+    auto acc = make_id(acc_id);
+
+    {
+        auto first_index = index;
+        first_index[last] = literal((int)0);
+        auto init = generate_expression(dot->init, first_index, ctx);
+        ctx->add(assign(acc, init));
+    }
+
+    int n = dot->size - 1;
+    if (n < 1)
+        return acc;
+
+    int lhs_stride, rhs_stride;
+    if (has_linear_layout(dot->lhs.get(), last, lhs_stride) &&
+            has_linear_layout(dot->rhs.get(), last, rhs_stride))
+    {
+        auto start_index = index;
+        start_index[last] = literal((int)1);
+        auto lhs = unop(op::address, generate_expression(dot->lhs, start_index, ctx));
+        auto rhs = unop(op::address, generate_expression(dot->rhs, start_index, ctx));
+
+        auto kernel = make_id("arrp::dot<" + type->name + ">");
+        auto sum = call(kernel, { lhs, literal(lhs_stride),
+                                  rhs, literal(rhs_stride),
+                                  literal(n) });
+        ctx->add(binop(op::assign_add, acc, sum));
+    }
+    else
+    {
+        // Elements are not laid out linearly in buffers,
+        // so accumulate in a loop.
+
+        auto i = make_id(ctx->new_var_id());
+
+        auto loop = make_shared<for_statement>();
+        loop->initialization = decl_expr(int_type(), *i, literal((int)1));
+        loop->condition = binop(op::lesser, i, literal(dot->size));
+        loop->update = unop(op::pre_incr, i);
+
+        auto body = new block_statement;
+        loop->body = statement_ptr(body);
+
+        auto elem_index = index;
+        elem_index[last] = i;
+
+        ctx->push(&body->statements);
+        auto lhs = generate_expression(dot->lhs, elem_index, ctx);
+        auto rhs = generate_expression(dot->rhs, elem_index, ctx);
+        ctx->add(binop(op::assign_add, acc, binop(op::mult, lhs, rhs)));
+        ctx->pop();
+
+        ctx->add(loop);
+    }
+
+    return acc;
+}
+
+// Conditionals are generated as "c ? a : b" when
+// both branches cost at most this much.
+static const int max_select_branch_cost = 6;
+
+// Estimated cost of evaluating an expression unconditionally,
+// or -1 if it may not be evaluated unless selected
+// (it might trap or access memory out of bounds).
+int cpp_from_polyhedral::speculation_cost(const functional::expr_ptr & expr)
+{
+    if (dynamic_cast<polyhedral::iterator_read*>(expr.get()) ||
+            dynamic_cast<functional::int_const*>(expr.get()) ||
+            dynamic_cast<functional::real_const*>(expr.get()) ||
+            dynamic_cast<functional::bool_const*>(expr.get()) ||
+            dynamic_cast<functional::complex_const*>(expr.get()))
+    {
+        return 0;
+    }
+    else if (auto read = dynamic_cast<polyhedral::array_read*>(expr.get()))
+    {
+        if (!is_in_bounds(read))
+            return -1;
+        int cost = 1;
+        for (auto & index : read->indexes)
+        {
+            int c = speculation_cost(index);
+            if (c < 0)
+                return -1;
+            cost += c;
+        }
+        return cost;
+    }
+    else if (auto op = dynamic_cast<functional::primitive*>(expr.get()))
+    {
+        int cost = 0;
+        for (auto & operand : op->operands)
+        {
+            int c = speculation_cost(operand);
+            if (c < 0)
+                return -1;
+            cost += c;
+        }
+
+        switch(op->kind)
+        {
+        case primitive_op::divide:
+        case primitive_op::divide_integer:
+        case primitive_op::modulo:
+        {
+            bool is_integer =
+                    prim_type(op->operands[0]) == primitive_type::integer &&
+                    prim_type(op->operands[1]) == primitive_type::integer;
+            if (is_integer || op->kind == primitive_op::modulo)
+            {
+                // Only division by non-zero constants can not trap.
+                auto divisor = dynamic_cast<functional::int_const*>(op->operands[1].expr.get());
+                if (!divisor || divisor->value == 0)
+                    return -1;
+            }
+            return cost + 4;
+        }
+        case primitive_op::sqrt:
+            return cost + 4;
+        case primitive_op::log:
+        case primitive_op::log2:
+        case primitive_op::log10:
+        case primitive_op::exp:
+        case primitive_op::exp2:
+        case primitive_op::raise:
+        case primitive_op::sin:
+        case primitive_op::cos:
+        case primitive_op::tan:
+        case primitive_op::asin:
+        case primitive_op::acos:
+        case primitive_op::atan:
+            return cost + 20;
+        default:
+            return cost + 1;
+        }
+    }
+
+    return -1;
+}
+
+// Is the element read by every statement instance within the array?
+bool cpp_from_polyhedral::is_in_bounds(polyhedral::array_read * read)
+{
+    if (!read->relation)
+        return false;
+
+    polyhedral::stmt_ptr stmt;
+    for (auto & s : m_model.statements)
+    {
+        if (s.get() == m_current_stmt)
+            stmt = s;
+    }
+    if (!stmt)
+        return false;
+
+    isl::map access = polyhedral::to_isl_map(stmt, *read->relation);
+    access = isl_map_intersect_domain(access.copy(), m_current_stmt->domain.copy());
+    auto elements = access.range();
+
+    return isl_set_is_subset(elements.get(), read->array->domain.get()) == isl_bool_true;
+}
+
 expression_ptr cpp_from_polyhedral::generate_expression
 (functional::expr_ptr expr, const index_type & index, builder * ctx)
 {
@@ -114,10 +440,31 @@ expression_ptr cpp_from_polyhedral::generate_expression
 
     expression_ptr result;
 
+    const string * key = nullptr;
+    if (m_value_numbering)
+    {
+        auto & k = value_key(expr);
+        if (m_value_counts.count(k))
+        {
+            if (auto value = find_value(k))
+                return value;
+            key = &k;
+        }
+    }
+
     if (auto operation = dynamic_cast<functional::primitive*>(expr.get()))
     {
         result = generate_primitive(operation, index, ctx);
     }
+    else if (auto dot = dynamic_cast<polyhedral::dot_product*>(expr.get()))
+    {
+        // Operands are read at other indexes than the statement's,
+        // and they must remain buffer elements.
+        bool numbering = m_value_numbering;
+        m_value_numbering = false;
+        result = generate_dot_product(dot, index, ctx);
+        m_value_numbering = numbering;
+    }
     else if (auto iterator = dynamic_cast<polyhedral::iterator_read*>(expr.get()))
     {
         assert(iterator->index >= 0 && iterator->index < index.size());
@@ -171,6 +518,9 @@ expression_ptr cpp_from_polyhedral::generate_expression
         throw error("Unexpected expression type.");
     }
 
+    if (key)
+        result = store_value(*key, result, prim_type(expr), ctx);
+
     return result;
 }
 
@@ -180,21 +530,54 @@ expression_ptr cpp_from_polyhedral::generate_primitive
     switch(expr->kind)
     {
     case primitive_op::logic_and:
+    case primitive_op::logic_or:
     {
         auto lhs = generate_expression(expr->operands[0], index, ctx);
+
+        // The right operand is evaluated only if needed,
+        // so it must not be computed into temporaries beforehand.
+        ++m_conditional_depth;
         auto rhs = generate_expression(expr->operands[1], index, ctx);
-        return make_shared<bin_op_expression>(op::logic_and, lhs, rhs);
+        --m_conditional_depth;
+
+        auto kind = expr->kind == primitive_op::logic_and ? op::logic_and : op::logic_or;
+        return make_shared<bin_op_expression>(kind, lhs, rhs);
     }
-    case primitive_op::logic_or:
+    case primitive_op::sin:
+    case primitive_op::cos:
     {
-        auto lhs = generate_expression(expr->operands[0], index, ctx);
-        auto rhs = generate_expression(expr->operands[1], index, ctx);
-        return make_shared<bin_op_expression>(op::logic_or, lhs, rhs);
+        if (auto result = generate_sincos(expr, index, ctx))
+            return result;
+        break;
     }
     case primitive_op::conditional:
     {
-        string id;
         auto type = type_for(prim_type(expr));
+
+        int true_cost = speculation_cost(expr->operands[1]);
+        int false_cost = speculation_cost(expr->operands[2]);
+        if (true_cost >= 0 && true_cost <= max_select_branch_cost &&
+                false_cost >= 0 && false_cost <= max_select_branch_cost)
+        {
+            // Both branches are cheap and safe to evaluate,
+            // so select without branching.
+
+            auto r_t = prim_type(expr);
+            auto branch = [&](int i) -> expression_ptr
+            {
+                auto e = generate_expression(expr->operands[i], index, ctx);
+                if (prim_type(expr->operands[i]) != r_t)
+                    e = cast(type, e);
+                return e;
+            };
+
+            auto condition_expr = generate_expression(expr->operands[0], index, ctx);
+            auto true_expr = branch(1);
+            auto false_expr = branch(2);
+            return make_shared<if_expression>(condition_expr, true_expr, false_expr);
+        }
+
+        string id;
         ctx->add(make_shared<expr_statement>(ctx->new_var(type, id)));
         auto id_expr = make_shared<id_expression>(id);
 
@@ -204,16 +587,20 @@ expression_ptr cpp_from_polyhedral::generate_primitive
         auto false_block = new block_statement;
 
         ctx->push(&true_block->statements);
+        m_values.emplace_back();
         auto true_expr = generate_expression(expr->operands[1], index, ctx);
         auto true_assign = make_shared<bin_op_expression>(op::assign, id_expr, true_expr);
         ctx->add(make_shared<expr_statement>(true_assign));
+        m_values.pop_back();
 
         ctx->pop();
 
         ctx->push(&false_block->statements);
+        m_values.emplace_back();
         auto false_expr = generate_expression(expr->operands[2], index, ctx);
         auto false_assign = make_shared<bin_op_expression>(op::assign, id_expr, false_expr);
         ctx->add(make_shared<expr_statement>(false_assign));
+        m_values.pop_back();
 
         ctx->pop();
 
@@ -470,6 +857,236 @@ expression_ptr cpp_from_polyhedral::generate_primitive
     }
 }
 
+// Computes sin(a) and cos(a) together, if both are needed
+// by the current statement.
+expression_ptr cpp_from_polyhedral::generate_sincos
+(functional::primitive * expr, const index_type & index, builder * ctx)
+{
+    if (!m_value_numbering || m_conditional_depth > 0)
+        return nullptr;
+
+    auto t = prim_type(expr);
+    if (t != primitive_type::real32 && t != primitive_type::real64)
+        return nullptr;
+
+    auto & arg = expr->operands[0].expr;
+    auto & arg_key = value_key(arg);
+    if (arg_key.empty() || m_trig_args[arg_key] != 3)
+        return nullptr;
+
+    auto type = type_for(t);
+
+    auto arg_expr = generate_expression(arg, index, ctx);
+    if (prim_type(arg) != t)
+        arg_expr = cast(type, arg_expr);
+
+    string sin_id, cos_id;
+    ctx->add(make_shared<expr_statement>(ctx->new_var(type, sin_id)));
+    ctx->add(make_shared<expr_statement>(ctx->new_var(type, cos_id)));
+    ctx->add(call(make_id("arrp::sincos"), { arg_expr, make_id(sin_id), make_id(cos_id) }));
+
+    m_uses_sincos = true;
+
+    auto key = [&](primitive_op kind)
+    {
+        ostringstream text;
+        text << "(" << kind << " " << arg_key << ")";
+        return text.str();
+    };
+
+    m_values.back()[key(primitive_op::sin)] = make_id(sin_id);
+    m_values.back()[key(primitive_op::cos)] = make_id(cos_id);
+
+    return make_id(expr->kind == primitive_op::sin ? sin_id : cos_id);
+}
+
+void cpp_from_polyhedral::start_value_numbering(const functional::expr_ptr & expr)
+{
+    m_value_numbering = true;
+    m_conditional_depth = 0;
+    m_value_keys.clear();
+    m_value_counts.clear();
+    m_trig_args.clear();
+    m_values.clear();
+    m_values.emplace_back();
+
+    unordered_set<string> seen;
+    count_values(expr, seen);
+}
+
+void cpp_from_polyhedral::end_value_numbering()
+{
+    m_value_numbering = false;
+    m_value_keys.clear();
+    m_value_counts.clear();
+    m_trig_args.clear();
+    m_values.clear();
+}
+
+// Structural key of an expression,
+// or an empty string if the expression is not numbered.
+const string & cpp_from_polyhedral::value_key(const functional::expr_ptr & expr)
+{
+    auto existing = m_value_keys.find(expr.get());
+    if (existing != m_value_keys.end())
+        return existing->second;
+
+    ostringstream key;
+    key << std::setprecision(17);
+    bool valid = true;
+
+    if (auto it = dynamic_cast<polyhedral::iterator_read*>(expr.get()))
+    {
+        key << "i" << it->index;
+    }
+    else if (auto c = dynamic_cast<functional::int_const*>(expr.get()))
+    {
+        key << c->value;
+    }
+    else if (auto c = dynamic_cast<functional::constant<double>*>(expr.get()))
+    {
+        key << prim_type(expr) << ":" << c->value;
+    }
+    else if (auto c = dynamic_cast<functional::bool_const*>(expr.get()))
+    {
+        key << (c->value ? "true" : "false");
+    }
+    else if (auto c = dynamic_cast<functional::complex_const*>(expr.get()))
+    {
+        key << prim_type(expr) << ":" << c->value;
+    }
+    else if (auto read = dynamic_cast<polyhedral::array_read*>(expr.get()))
+    {
+        key << read->array->name << "[";
+        for (auto & index : read->indexes)
+        {
+            auto & k = value_key(index);
+            valid &= !k.empty();
+            key << k << ",";
+        }
+        key << "]";
+    }
+    else if (auto op = dynamic_cast<functional::primitive*>(expr.get()))
+    {
+        key << "(" << op->kind;
+        for (auto & operand : op->operands)
+        {
+            auto & k = value_key(operand);
+            valid &= !k.empty();
+            key << " " << k;
+        }
+        key << ")";
+    }
+    else
+    {
+        valid = false;
+    }
+
+    auto & result = m_value_keys[expr.get()];
+    if (valid)
+        result = key.str();
+    return result;
+}
+
+// Counts uses of each value, as they will be generated:
+// the subexpressions of a repeated value are only counted once.
+void cpp_from_polyhedral::count_values
+(const functional::expr_ptr & expr, unordered_set<string> & seen)
+{
+    auto & key = value_key(expr);
+    auto read = dynamic_cast<polyhedral::array_read*>(expr.get());
+    auto op = dynamic_cast<functional::primitive*>(expr.get());
+
+    bool is_numbered = !key.empty() && (read || op);
+
+    // Integer index arithmetic is cheaper than a temporary.
+    if (op && prim_type(op) == primitive_type::integer)
+    {
+        switch(op->kind)
+        {
+        case primitive_op::add:
+        case primitive_op::subtract:
+        case primitive_op::negate:
+        case primitive_op::multiply:
+            is_numbered = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (is_numbered)
+    {
+        if (seen.count(key))
+        {
+            ++m_value_counts[key];
+            return;
+        }
+        seen.insert(key);
+        m_value_counts[key] = 1;
+    }
+
+    if (op)
+    {
+        if (op->kind == primitive_op::sin || op->kind == primitive_op::cos)
+        {
+            auto & arg = value_key(op->operands[0]);
+            if (!arg.empty())
+                m_trig_args[arg] |= op->kind == primitive_op::sin ? 1 : 2;
+        }
+
+        for (auto & operand : op->operands)
+            count_values(operand, seen);
+    }
+    else if (read)
+    {
+        for (auto & index : read->indexes)
+            count_values(index, seen);
+    }
+    else if (auto call = dynamic_cast<polyhedral::external_call*>(expr.get()))
+    {
+        for (auto & arg : call->args)
+            count_values(arg, seen);
+    }
+}
+
+expression_ptr cpp_from_polyhedral::find_value(const string & key)
+{
+    for (auto scope = m_values.rbegin(); scope != m_values.rend(); ++scope)
+    {
+        auto value = scope->find(key);
+        if (value != scope->end())
+            return value->second;
+    }
+    return nullptr;
+}
+
+// Stores a value used more than once into a temporary.
+expression_ptr cpp_from_polyhedral::store_value
+(const string & key, expression_ptr value, primitive_type type, builder * ctx)
+{
+    if (m_values.empty())
+        return value;
+
+    if (dynamic_pointer_cast<id_expression>(value))
+    {
+        m_values.back()[key] = value;
+        return value;
+    }
+
+    if (m_conditional_depth > 0 || m_value_counts[key] < 2)
+        return value;
+
+    string id;
+    auto decl = ctx->new_var(type_for(type), id);
+    static_pointer_cast<var_decl_expression>(decl)->decl->value = value;
+    ctx->add(make_shared<expr_statement>(decl));
+
+    auto var = make_id(id);
+    m_values.back()[key] = var;
+    return var;
+}
+
 expression_ptr cpp_from_polyhedral::generate_buffer_access
 (polyhedral::array_ptr array, const index_type & index, builder * ctx)
 {
@@ -28,6 +28,7 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #include "../common/functional_model.hpp"
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 
 namespace stream {
@@ -35,6 +36,7 @@ namespace cpp_gen {
 
 using std::vector;
 using std::unordered_map;
+using std::unordered_set;
 using std::string;
 
 class cpp_from_polyhedral
@@ -58,14 +60,41 @@ public:
 
     expression_ptr generate_buffer_phase(const string & id, builder *);
 
+    // Was arrp::sincos used in generated code?
+    bool uses_sincos() const { return m_uses_sincos; }
+
 private:
 
+    void generate_transform
+    (polyhedral::statement *, polyhedral::transform_call *,
+     const index_type&, builder*);
+
+    expression_ptr generate_dot_product
+    (polyhedral::dot_product*, const index_type&, builder*);
+
+    bool has_linear_layout(polyhedral::array_read*, int iterator, int & stride);
+
+    int speculation_cost(const functional::expr_ptr &);
+
+    bool is_in_bounds(polyhedral::array_read *);
+
     expression_ptr generate_expression
     (functional::expr_ptr, const index_type&, builder*);
 
     expression_ptr generate_primitive
     (functional::primitive*, const index_type&, builder*);
 
+    expression_ptr generate_sincos
+    (functional::primitive*, const index_type&, builder*);
+
+    void start_value_numbering(const functional::expr_ptr &);
+    void end_value_numbering();
+    const string & value_key(const functional::expr_ptr &);
+    void count_values(const functional::expr_ptr &, unordered_set<string> & seen);
+    expression_ptr find_value(const string & key);
+    expression_ptr store_value(const string & key, expression_ptr,
+                               primitive_type, builder *);
+
     expression_ptr generate_buffer_access
     (polyhedral::array_ptr, const index_type&, builder*);
 
@@ -78,6 +107,18 @@ private:
     bool m_in_period = false;
     polyhedral::statement * m_current_stmt = nullptr;
     name_mapper & m_name_mapper;
+
+    // Value numbering of subexpressions in the current statement.
+    // Keys are structural, so equal subexpressions have equal keys.
+    // Values are temporaries, in nested scopes of generated blocks.
+    bool m_value_numbering = false;
+    int m_conditional_depth = 0;
+    unordered_map<functional::expression*, string> m_value_keys;
+    unordered_map<string,int> m_value_counts;
+    // Arguments of sin (bit 1) and cos (bit 2)
+    unordered_map<string,int> m_trig_args;
+    vector<unordered_map<string,expression_ptr>> m_values;
+    bool m_uses_sincos = false;
 };
 
 }
@@ -24,10 +24,14 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 #include "cpp_from_isl.hpp"
 #include "../utility/cpp-gen.hpp"
 
+#include <json++/json.hh>
+
 #include <unordered_map>
+#include <map>
 #include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <sstream>
 
 using namespace std;
 
@@ -145,6 +149,32 @@ variable_decl_ptr buffer_decl(polyhedral::array_ptr array,
         return make_shared<array_decl>(elem_type, namer(array->name), array->buffer_size);
 }
 
+struct fft_plan
+{
+    int size;
+    primitive_type type;
+};
+
+static map<string,fft_plan> fft_plans(const polyhedral::model & model)
+{
+    map<string,fft_plan> plans;
+
+    for (const auto & stmt : model.statements)
+    {
+        auto transform = dynamic_pointer_cast<polyhedral::transform_call>(stmt->expr);
+        if (!transform)
+            continue;
+
+        fft_plan plan;
+        plan.size = transform->size;
+        plan.type = stmt->write_relation.array->type;
+
+        plans.emplace(fft_plan_name(plan.size, plan.type), plan);
+    }
+
+    return plans;
+}
+
 class_node * state_type_def(const polyhedral::model & model,
                             unordered_map<string,buffer> & buffers,
                             name_mapper & namer)
@@ -190,6 +220,14 @@ class_node * state_type_def(const polyhedral::model & model,
         sec.members.push_back(make_shared<data_field>(field));
     }
 
+    for (const auto & plan : fft_plans(model))
+    {
+        string type_name = plan.second.type == primitive_type::complex32 ?
+                    "arrp::fft_plan<float>" : "arrp::fft_plan<double>";
+        auto field = decl(make_shared<basic_type>(type_name), plan.first);
+        sec.members.push_back(make_shared<data_field>(field));
+    }
+
     return def;
 }
 
@@ -409,10 +447,301 @@ void add_output_getter_func(cpp_gen::module &module, namespace_node & nmspc,
     nmspc.members.push_back(func);
 }
 #endif
+static int instance_count(const isl::union_map & schedule,
+                          const polyhedral::statement & stmt)
+{
+    auto domain = schedule.in_domain(stmt.domain).domain()
+            .set_for(stmt.domain.get_space());
+    if (domain.is_empty())
+        return 0;
+
+    // Output statements have a single dimension.
+    auto t = domain.get_space()(isl::space::variable, 0);
+    return domain.maximum(t).integer() - domain.minimum(t).integer() + 1;
+}
+
+int kernel_info::buffer_bytes(bool on_stack) const
+{
+    int bytes = 0;
+    for (const auto & buf : buffers)
+    {
+        if (buf.on_stack == on_stack)
+            bytes += volume(buf.size) * size_for(buf.type);
+    }
+    return bytes;
+}
+
+kernel_info describe_kernel(const polyhedral::model & model,
+                            const polyhedral::schedule & schedule)
+{
+    kernel_info info;
+
+    auto buffers = buffer_analysis(model);
+
+    for (const auto & array : model.arrays)
+    {
+        kernel_info::buffer_info buf;
+        buf.name = array->name;
+        buf.type = array->type;
+        buf.size = array->buffer_size;
+        buf.on_stack = buffers[array->name].on_stack;
+        info.buffers.push_back(buf);
+    }
+
+    for (const auto & stmt : model.statements)
+    {
+        auto call = dynamic_pointer_cast<polyhedral::external_call>(stmt->expr);
+        if (!call || call->name != "output")
+            continue;
+
+        auto read = dynamic_pointer_cast<polyhedral::array_read>(call->args[0]);
+        assert(read);
+        auto & array = read->array;
+
+        info.output.type = array->type;
+        if (!array->size.empty())
+            info.output.size.assign(array->size.begin() + 1, array->size.end());
+
+        // The output statement may be split into several.
+        info.output.init_count += instance_count(schedule.prelude, *stmt);
+        info.output.period_count += instance_count(schedule.period, *stmt);
+    }
+
+    return info;
+}
+
+static string numerical_type_name(primitive_type type)
+{
+    switch(type)
+    {
+    case primitive_type::boolean:
+    case primitive_type::integer:
+        return "integer";
+    case primitive_type::real32:
+    case primitive_type::real64:
+        return "real";
+    case primitive_type::complex32:
+    case primitive_type::complex64:
+        return "complex";
+    default:
+        throw error("Unexpected primitive type.");
+    }
+}
+
+static string element_type_name(primitive_type type)
+{
+    return dynamic_pointer_cast<basic_type>(type_for(type))->name;
+}
+
+static JSON::Array json_sizes(const vector<int> & size)
+{
+    JSON::Array a;
+    for (int s : size)
+        a.push_back(s);
+    return a;
+}
+
+void write_kernel_info(const string & name, const kernel_info & info, ostream & out)
+{
+    JSON::Object output;
+    output["type"] = numerical_type_name(info.output.type);
+    output["element_type"] = element_type_name(info.output.type);
+    output["size"] = json_sizes(info.output.size);
+    output["init"] = info.output.init_count;
+    output["period"] = info.output.period_count;
+    output["staging_latency"] = info.staging_latency();
+
+    JSON::Array buffers;
+    for (const auto & buf : info.buffers)
+    {
+        JSON::Object b;
+        b["name"] = buf.name;
+        b["type"] = numerical_type_name(buf.type);
+        b["element_type"] = element_type_name(buf.type);
+        b["size"] = volume(buf.size);
+        b["dimensions"] = json_sizes(buf.size);
+        b["bytes"] = volume(buf.size) * size_for(buf.type);
+        b["location"] = buf.on_stack ? "stack" : "state";
+        buffers.push_back(b);
+    }
+
+    JSON::Object memory;
+    memory["state_buffer_bytes"] = info.buffer_bytes(false);
+    memory["stack_buffer_bytes"] = info.buffer_bytes(true);
+
+    JSON::Object doc;
+    doc["name"] = name;
+    doc["inputs"] = JSON::Array();
+    doc["output"] = output;
+    doc["buffers"] = buffers;
+    doc["memory"] = memory;
+
+    // json++ declares its operators in the global namespace.
+    ::operator<<(out, doc) << std::endl;
+}
+
+static void add_info_members(namespace_node * nmspc, class_node * state,
+                             const kernel_info & info)
+{
+    auto & sec = state->sections[0];
+
+    auto constant = [&](const string & name, int value)
+    {
+        auto type = make_shared<basic_type>("int");
+        sec.members.push_back(make_shared<static_constant>(type, name, literal(value)));
+
+        auto def = make_shared<static_constant_def>("state<IO>", type, name);
+        def->template_parameters.push_back("IO");
+        nmspc->members.push_back(def);
+    };
+
+    sec.members.push_back(make_shared<using_decl>
+                          ("output_type = " + element_type_name(info.output.type)));
+    constant("output_element_count", info.output_element_count());
+    constant("output_init_count", info.output.init_count);
+    constant("output_period_count", info.output.period_count);
+    constant("state_buffer_bytes", info.buffer_bytes(false));
+    constant("stack_buffer_bytes", info.buffer_bytes(true));
+}
+
+// Instrumentation of generated code for profiling.
+// Loop nests are numbered in order of generation.
+// An occurrence is a statement within a loop nest.
+struct profiler
+{
+    struct occurrence
+    {
+        int nest;
+        string statement;
+    };
+
+    int nest_count = 0;
+    int current_nest = -1;
+    vector<occurrence> occurrences;
+    map<pair<int,string>,int> occurrence_index;
+
+    string start_var(int nest) const
+    {
+        return "profile_start_" + to_string(nest);
+    }
+
+    void begin_nest(builder * ctx)
+    {
+        current_nest = nest_count++;
+        auto start = call(make_id("arrp::profile_clock"), {});
+        ctx->add(decl_expr(make_shared<basic_type>("uint64_t"),
+                           start_var(current_nest), start));
+    }
+
+    void end_nest(builder * ctx)
+    {
+        auto counter = make_shared<array_access_expression>
+                (make_id("profile_nests"), vector<expression_ptr>{ literal(current_nest) });
+        ctx->add(call(make_id("arrp::profile_record"),
+                      { counter, make_id(start_var(current_nest)) }));
+    }
+
+    void count_iteration(const string & statement, builder * ctx)
+    {
+        auto key = make_pair(current_nest, statement);
+        auto it = occurrence_index.find(key);
+        if (it == occurrence_index.end())
+        {
+            it = occurrence_index.emplace(key, (int) occurrences.size()).first;
+            occurrences.push_back({ current_nest, statement });
+        }
+
+        auto counter = make_shared<array_access_expression>
+                (make_id("profile_iterations"), vector<expression_ptr>{ literal(it->second) });
+        ctx->add(unop(op::pre_incr, counter));
+    }
+
+    void add_state_members(class_node * state)
+    {
+        auto & sec = state->sections[0];
+
+        sec.members.push_back(make_shared<data_field>(make_shared<array_decl>
+            (make_shared<basic_type>("arrp::profile_counter"), "profile_nests",
+             vector<int>{ std::max(1, nest_count) })));
+
+        sec.members.push_back(make_shared<data_field>(make_shared<array_decl>
+            (make_shared<basic_type>("uint64_t"), "profile_iterations",
+             vector<int>{ std::max(1, (int) occurrences.size()) })));
+
+        sec.members.push_back(make_shared<func_decl>(report_signature()));
+    }
+
+    static func_sig_ptr report_signature(const string & name = "profile")
+    {
+        auto report_type = make_shared<basic_type>("arrp::profile_report");
+        return make_shared<func_signature>
+                (name, vector<variable_decl_ptr>{ decl(reference(report_type), "report") });
+    }
+
+    void add_reset(func_def & initialize)
+    {
+        auto & stmts = initialize.body.statements;
+        vector<statement_ptr> reset =
+        {
+            make_shared<expr_statement>(call(make_id("arrp::profile_clear"),
+                                             { make_id("profile_nests") })),
+            make_shared<expr_statement>(call(make_id("arrp::profile_clear"),
+                                             { make_id("profile_iterations") }))
+        };
+        stmts.insert(stmts.begin(), reset.begin(), reset.end());
+    }
+
+    shared_ptr<func_def> report_function(const polyhedral::model & model)
+    {
+        auto sig = report_signature("state<IO>::profile");
+        sig->inlining = explicit_inline;
+        sig->template_parameters.push_back("IO");
+
+        auto func = make_shared<func_def>(sig);
+        auto & stmts = func->body.statements;
+        auto report = make_id("report");
+
+        for (int n = 0; n < nest_count; ++n)
+        {
+            auto counter = make_shared<array_access_expression>
+                    (make_id("profile_nests"), vector<expression_ptr>{ literal(n) });
+            stmts.push_back(make_shared<expr_statement>
+                            (call(binop(op::member_of_reference, report, make_id("nest")),
+                                  { literal(n), counter })));
+        }
+
+        for (int i = 0; i < (int) occurrences.size(); ++i)
+        {
+            auto & occ = occurrences[i];
+
+            string location;
+            for (const auto & stmt : model.statements)
+            {
+                if (stmt->name == occ.statement && stmt->expr)
+                {
+                    ostringstream text;
+                    text << stmt->expr->location;
+                    location = text.str();
+                }
+            }
+
+            auto counter = make_shared<array_access_expression>
+                    (make_id("profile_iterations"), vector<expression_ptr>{ literal(i) });
+            stmts.push_back(make_shared<expr_statement>
+                            (call(binop(op::member_of_reference, report, make_id("statement")),
+                                  { literal(occ.statement), literal(location),
+                                    literal(occ.nest), counter })));
+        }
+
+        return func;
+    }
+};
+
 void generate(const string & name,
               const polyhedral::model & model,
               const polyhedral::ast_isl & ast,
-              std::ostream & src_stream)
+              std::ostream & src_stream,
+              const generator_options & options)
 {
     unordered_map<string,buffer> buffers = buffer_analysis(model);
 
@@ -426,6 +755,26 @@ void generate(const string & name,
     m.members.push_back(make_shared<include_dir>("cmath"));
     m.members.push_back(make_shared<include_dir>("algorithm"));
     m.members.push_back(make_shared<include_dir>("complex"));
+
+    auto plans = fft_plans(model);
+    if (!plans.empty())
+        m.members.push_back(make_shared<include_dir>("arrp/fft.hpp"));
+
+    bool uses_kernels = false;
+    for (const auto & stmt : model.statements)
+    {
+        if (dynamic_pointer_cast<polyhedral::dot_product>(stmt->expr))
+            uses_kernels = true;
+    }
+    if (uses_kernels)
+        m.members.push_back(make_shared<include_dir>("arrp/kernels.hpp"));
+
+    if (options.instrument)
+        m.members.push_back(make_shared<include_dir>("arrp/profile.hpp"));
+
+    // Whether arrp/math.hpp is needed is only known after generating statements.
+    auto math_include_pos = m.members.size();
+
     m.members.push_back(make_shared<using_decl>("namespace std"));
 
     auto nmspc = make_shared<namespace_node>();
@@ -435,7 +784,13 @@ void generate(const string & name,
     //add_remainder_function(m,*nmspc);
 
     // FIXME: rather include header:
-    nmspc->members.push_back(namespace_member_ptr(state_type_def(model,buffers,name_mapper)));
+    auto state_def = state_type_def(model,buffers,name_mapper);
+    nmspc->members.push_back(namespace_member_ptr(state_def));
+
+    if (options.info)
+        add_info_members(nmspc.get(), state_def, *options.info);
+
+    profiler prof;
 
     // FIXME: not of much use with infinite I/O
     //add_output_getter_func(m, *nmspc, model.arrays.back());
@@ -445,7 +800,34 @@ void generate(const string & name,
             const vector<expression_ptr> & index,
             builder * ctx)
     {
+        if (options.instrument)
+            prof.count_iteration(name, ctx);
+
+        const functional::expression * expr = nullptr;
+        if (options.line_directives)
+        {
+            for (const auto & stmt : model.statements)
+            {
+                if (stmt->name == name)
+                    expr = stmt->expr.get();
+            }
+            if (expr && (!expr->location.module ||
+                         expr->location.module->source.path.empty() ||
+                         expr->location.range.is_empty()))
+                expr = nullptr;
+        }
+
+        if (expr)
+        {
+            ctx->add(make_shared<line_directive>
+                     (expr->location.range.start.line,
+                      expr->location.module->source.path));
+        }
+
         poly.generate_statement(name, index, ctx);
+
+        if (expr)
+            ctx->add(make_shared<line_directive>());
     };
 
     auto id_func = std::bind(&cpp_from_polyhedral::generate_buffer_phase,
@@ -456,12 +838,35 @@ void generate(const string & name,
     isl.set_stmt_func(stmt_func);
     isl.set_id_func(id_func);
 
+    if (options.instrument)
+    {
+        isl.set_nest_func([&](bool begin, builder * ctx){
+            if (begin)
+                prof.begin_nest(ctx);
+            else
+                prof.end_nest(ctx);
+        });
+    }
+
     {
         auto sig = make_shared<func_signature>("state<IO>::initialize", explicit_inline);
         sig->template_parameters.push_back("IO");
 
         auto func = make_shared<func_def>(sig);
 
+        b.set_current_function(sig.get());
+
+        b.push(&func->body.statements);
+
+        for (const auto & plan : plans)
+        {
+            auto prepare = binop(op::member_of_reference,
+                                 make_id(plan.first), make_id("prepare"));
+            b.add(call(prepare, { literal(plan.second.size) }));
+        }
+
+        b.pop();
+
         if (ast.prelude)
         {
             b.set_current_function(sig.get());
@@ -481,6 +886,9 @@ void generate(const string & name,
             b.pop();
         }
 
+        if (options.instrument)
+            prof.add_reset(*func);
+
         nmspc->members.push_back(func);
     }
 
@@ -513,11 +921,32 @@ void generate(const string & name,
         nmspc->members.push_back(func);
     }
 
+    if (options.instrument)
+    {
+        prof.add_state_members(state_def);
+        nmspc->members.push_back(prof.report_function(model));
+    }
+
+    if (poly.uses_sincos())
+    {
+        m.members.insert(m.members.begin() + math_include_pos,
+                         make_shared<include_dir>("arrp/math.hpp"));
+    }
+
     {
         cpp_gen::options opt;
         opt.indentation_size = 2;
         cpp_gen::state gen_state(opt);
-        m.generate(gen_state, src_stream);
+        if (options.line_directives)
+        {
+            ostringstream code;
+            m.generate(gen_state, code);
+            src_stream << restore_line_directives(code.str(), options.filename);
+        }
+        else
+        {
+            m.generate(gen_state, src_stream);
+        }
     }
 #if 0
     {
@@ -558,5 +987,535 @@ void generate(const string & name,
 #endif
 }
 
+
+void generate_benchmark(const string & nmspace,
+                        const string & kernel_filename,
+                        const polyhedral::ast_isl & ast,
+                        std::ostream & out,
+                        const generator_options & options)
+{
+    bool streaming = ast.period != nullptr;
+
+    out << "#include \"" << kernel_filename << "\"" << endl;
+    out <<
+R"(
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Benchmark of a kernel generated by arrp.
+// Usage: <program> [--periods <n>] [--repeat <n>] [--json]
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+double elapsed_ns(bench_clock::time_point start, bench_clock::time_point end)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Consumes all outputs into a checksum,
+// so that their computation can not be eliminated.
+struct io_sink
+{
+    unsigned checksum = 0;
+    long outputs = 0;
+
+    template <typename T>
+    void output(T * data)
+    {
+        auto bytes = reinterpret_cast<const unsigned char*>(data);
+        for (unsigned i = 0; i < sizeof(T); ++i)
+            checksum = checksum * 31 + bytes[i];
+        ++outputs;
+    }
+};
+
+)";
+    out << "using kernel_state = " << nmspace << "::state<io_sink>;" << endl;
+    out << "const bool streaming = " << (streaming ? "true" : "false") << ";" << endl;
+
+    out <<
+R"(
+}
+
+int main(int argc, char * argv[])
+{
+    long periods = 10000;
+    int repetitions = 5;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--periods") == 0 && i + 1 < argc)
+            periods = std::atol(argv[++i]);
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repetitions = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--json") == 0)
+            json = true;
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--periods <n>] [--repeat <n>] [--json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (!streaming)
+        periods = 0;
+
+    io_sink io;
+
+    // Throughput: initialize and all periods, best of all repetitions.
+
+    double best_init_ns = std::numeric_limits<double>::max();
+    double best_run_ns = std::numeric_limits<double>::max();
+    double best_periods_ns = std::numeric_limits<double>::max();
+    long init_outputs = 0;
+    long period_outputs = 0;
+
+    for (int r = 0; r < repetitions; ++r)
+    {
+        std::unique_ptr<kernel_state> s(new kernel_state);
+        s->io = &io;
+
+        io.outputs = 0;
+        auto start = bench_clock::now();
+        s->initialize();
+        auto init_end = bench_clock::now();
+        init_outputs = io.outputs;
+        for (long p = 0; p < periods; ++p)
+            s->process();
+        auto end = bench_clock::now();
+        period_outputs = io.outputs - init_outputs;
+
+        best_init_ns = std::min(best_init_ns, elapsed_ns(start, init_end));
+        best_periods_ns = std::min(best_periods_ns, elapsed_ns(init_end, end));
+        best_run_ns = std::min(best_run_ns, elapsed_ns(start, end));
+    }
+
+    // Latency: each period timed separately.
+
+    std::vector<double> latency;
+    latency.reserve(periods);
+    {
+        std::unique_ptr<kernel_state> s(new kernel_state);
+        s->io = &io;
+        s->initialize();
+        for (long p = 0; p < periods; ++p)
+        {
+            auto start = bench_clock::now();
+            s->process();
+            auto end = bench_clock::now();
+            latency.push_back(elapsed_ns(start, end));
+        }
+)";
+    if (options.instrument)
+    {
+        out <<
+R"(
+        // Profile of initialize and the above periods.
+        arrp::profile_report report;
+        s->profile(report);
+        report.print(std::cerr);
+)";
+    }
+    out <<
+R"(    }
+    std::sort(latency.begin(), latency.end());
+
+    auto percentile = [&](double f) -> double {
+        if (latency.empty())
+            return 0;
+        long i = std::min<long>(latency.size() - 1, long(f * latency.size()));
+        return latency[i];
+    };
+
+    double outputs_per_second =
+            best_periods_ns > 0 ? period_outputs * 1e9 / best_periods_ns : 0;
+    double periods_per_second =
+            best_periods_ns > 0 ? periods * 1e9 / best_periods_ns : 0;
+
+    if (json)
+    {
+        std::printf("{\"state_bytes\": %lu, \"periods\": %ld, \"repetitions\": %d, "
+                    "\"initialize_ns\": %.0f, \"best_run_ns\": %.0f, "
+                    "\"outputs_per_period\": %.3f, \"outputs_per_second\": %.0f, "
+                    "\"periods_per_second\": %.0f, "
+                    "\"period_latency_ns\": {\"min\": %.0f, \"median\": %.0f, "
+                    "\"p90\": %.0f, \"p99\": %.0f, \"max\": %.0f}, "
+                    "\"checksum\": %u}\n",
+                    (unsigned long) sizeof(kernel_state), periods, repetitions,
+                    best_init_ns, best_run_ns,
+                    periods ? double(period_outputs) / periods : 0.0,
+                    outputs_per_second, periods_per_second,
+                    percentile(0), percentile(0.5), percentile(0.9), percentile(0.99),
+                    latency.empty() ? 0.0 : latency.back(),
+                    io.checksum);
+        return 0;
+    }
+
+    std::printf("State size: %lu bytes\n", (unsigned long) sizeof(kernel_state));
+    std::printf("Initialize: %.0f ns (%ld outputs)\n", best_init_ns, init_outputs);
+    if (periods > 0)
+    {
+        std::printf("Periods: %ld, %.3f outputs per period\n",
+                    periods, double(period_outputs) / periods);
+        std::printf("Throughput: %.0f outputs/s, %.0f periods/s\n",
+                    outputs_per_second, periods_per_second);
+        std::printf("Period latency: min %.0f ns, median %.0f ns,"
+                    " p90 %.0f ns, p99 %.0f ns, max %.0f ns\n",
+                    percentile(0), percentile(0.5), percentile(0.9), percentile(0.99),
+                    latency.back());
+    }
+    std::printf("Checksum: %u\n", io.checksum);
+
+    return 0;
+}
+)";
+}
+
+// Name of C symbols for a kernel in namespace 'nmspace'.
+string c_api_prefix(const string & nmspace)
+{
+    string prefix = nmspace;
+    for (auto & c : prefix)
+    {
+        if (!isalnum((unsigned char) c))
+            c = '_';
+    }
+    return prefix;
+}
+
+void generate_c_header(const string & nmspace,
+                       const kernel_info & info,
+                       std::ostream & out)
+{
+    string prefix = c_api_prefix(nmspace);
+
+    string guard = prefix + "_C_H_INCLUDED";
+    for (auto & c : guard)
+        c = toupper((unsigned char) c);
+
+    // Complex values are passed as pairs of real and imaginary parts.
+    primitive_type scalar_type = info.output.type;
+    int scalar_count = info.output_element_count();
+    if (scalar_type == primitive_type::complex32)
+    {
+        scalar_type = primitive_type::real32;
+        scalar_count *= 2;
+    }
+    else if (scalar_type == primitive_type::complex64)
+    {
+        scalar_type = primitive_type::real64;
+        scalar_count *= 2;
+    }
+
+    out << "#ifndef " << guard << endl
+        << "#define " << guard << endl;
+    out <<
+R"(
+/*
+C interface of a kernel generated by arrp.
+
+Each output consists of 'output_scalar_count' values of type
+'output_scalar' (complex values are pairs of real and imaginary parts,
+booleans are bytes of value 0 or 1).
+Blocks of outputs are written to out[0], which must have space for
+the requested number of outputs.
+
+Create and initialize a state using either create() or, to place the
+state in memory provided by the caller, state_size(), state_align() and
+construct(). Then call reset() before processing.
+*/
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+)";
+    // C has no 'bool' without <stdbool.h>, and FFI hosts may not know it.
+    string scalar_type_name = scalar_type == primitive_type::boolean ?
+                "unsigned char" : element_type_name(scalar_type);
+
+    out << "typedef " << scalar_type_name
+        << " " << prefix << "_output_scalar;" << endl << endl;
+
+    out << "enum" << endl << "{" << endl
+        << "    " << prefix << "_output_scalar_count = " << scalar_count << "," << endl
+        << "    " << prefix << "_output_init_count = " << info.output.init_count << "," << endl
+        << "    " << prefix << "_output_period_count = " << info.output.period_count << "," << endl
+        << "    /* Maximum number of outputs held for the next process_block() call. */" << endl
+        << "    " << prefix << "_staging_latency = " << info.staging_latency() << endl
+        << "};" << endl << endl;
+
+    auto decl = [&](const string & ret, const string & name, const string & params)
+    {
+        out << ret << " " << prefix << "_" << name << "(" << params << ");" << endl;
+    };
+
+    decl("size_t", "state_size", "void");
+    decl("size_t", "state_align", "void");
+    decl("void", "construct", "void * state");
+    decl("void", "destruct", "void * state");
+    decl("void *", "create", "void");
+    decl("void", "destroy", "void * state");
+    out << endl;
+    out << "/* Runs initialize() and writes the "
+           "output_init_count outputs to out[0].\n"
+           "   If 'out' is NULL, the outputs are discarded.\n"
+           "   Returns the number of outputs. */" << endl;
+    decl("long", "reset", "void * state, void * const * out");
+    out << endl;
+    out << "/* Writes n_samples outputs to out[0]. The kernel has no inputs,\n"
+           "   so 'in' is unused.\n"
+           "   Outputs of a period which exceed n_samples are staged and\n"
+           "   written first by the next call. When n_samples is a multiple\n"
+           "   of output_period_count and nothing is staged, outputs are\n"
+           "   written directly to out[0] without copying.\n"
+           "   Returns the number of outputs, which is less than n_samples\n"
+           "   only when a finite kernel has no more outputs,\n"
+           "   or -1 if n_samples is negative. */" << endl;
+    decl("long", "process_block",
+         "void * state, const void * const * in, void * const * out, long n_samples");
+
+    out <<
+R"(
+#ifdef __cplusplus
+}
+#endif
+
+)";
+    out << "#endif /* " << guard << " */" << endl;
+}
+
+void generate_c_api(const string & nmspace,
+                    const string & kernel_filename,
+                    const string & header_filename,
+                    const kernel_info & info,
+                    std::ostream & out)
+{
+    string prefix = c_api_prefix(nmspace);
+
+    int output_size = info.output_bytes();
+
+    out << "#include \"" << kernel_filename << "\"" << endl;
+    out << "#include \"" << header_filename << "\"" << endl;
+    out <<
+R"(
+#include <arrp/kernel.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// Named, so that the kernel namespace can not hide these names,
+// and unnamed inside, so that several kernels can be linked together.
+namespace arrp_c_api_detail {
+namespace {
+
+)";
+    out << "const size_t output_size = " << output_size << ";" << endl;
+    out << "const int output_init_count = " << info.output.init_count << ";" << endl;
+    out << "const int output_period_count = " << info.output.period_count << ";" << endl;
+    out << "const size_t staging_size = output_size * output_period_count;" << endl;
+    if (info.output.type == primitive_type::boolean)
+    {
+        out << "static_assert(sizeof(bool) == 1,"
+            << " \"Boolean outputs are declared as bytes in the C header.\");" << endl;
+    }
+    out <<
+R"(
+// Copies outputs into a block if given,
+// else passes them to a function if given.
+struct c_io
+{
+    arrp_output_func func = nullptr;
+    void * user = nullptr;
+    unsigned char * block = nullptr;
+
+    template <typename T>
+    void output(T * data)
+    {
+        if (block)
+        {
+            std::memcpy(block, data, output_size);
+            block += output_size;
+        }
+        else if (func)
+        {
+            func(user, data);
+        }
+    }
+};
+
+)";
+    out << "using kernel_state = ::" << nmspace << "::state<c_io>;" << endl;
+    out <<
+R"(
+struct kernel_object
+{
+    kernel_state state;
+    c_io io;
+
+    // Outputs of the last period not yet delivered by process_block().
+    unsigned char staging[staging_size > 0 ? staging_size : 1];
+    long staged_begin = 0;
+    long staged_count = 0;
+};
+
+kernel_object * object(void * mem) { return static_cast<kernel_object*>(mem); }
+
+void construct(void * mem, arrp_output_func func, void * user)
+{
+    auto obj = new (mem) kernel_object;
+    obj->io.func = func;
+    obj->io.user = user;
+    obj->state.io = &obj->io;
+}
+
+void destruct(void * mem) { object(mem)->~kernel_object(); }
+void initialize(void * mem) { object(mem)->state.initialize(); }
+void process(void * mem) { object(mem)->state.process(); }
+
+long reset(void * mem, void * const * out)
+{
+    auto obj = object(mem);
+    auto io = obj->io;
+    obj->~kernel_object();
+    new (obj) kernel_object;
+    obj->state.io = &obj->io;
+
+    if (out && out[0])
+        obj->io.block = static_cast<unsigned char*>(out[0]);
+    obj->state.initialize();
+
+    obj->io = io;
+    obj->io.block = nullptr;
+    return output_init_count;
+}
+
+long process_block(void * mem, const void * const *, void * const * out, long n_samples)
+{
+    if (n_samples < 0)
+        return -1;
+
+    auto obj = object(mem);
+    auto block = static_cast<unsigned char*>(out[0]);
+    long remaining = n_samples;
+
+    // Outputs staged by the previous call come first.
+
+    long count = std::min(remaining, obj->staged_count);
+    if (count > 0)
+    {
+        std::memcpy(block, obj->staging + obj->staged_begin * output_size,
+                    count * output_size);
+        block += count * output_size;
+        remaining -= count;
+        obj->staged_begin += count;
+        obj->staged_count -= count;
+    }
+
+    if (output_period_count == 0)
+        return n_samples - remaining;
+
+    // Whole periods are written directly into the block.
+
+    obj->io.block = block;
+    for (long p = remaining / output_period_count; p > 0; --p)
+        obj->state.process();
+    block = obj->io.block;
+    remaining %= output_period_count;
+
+    // The rest is taken from one more period, staging its remaining outputs.
+
+    if (remaining > 0)
+    {
+        obj->io.block = obj->staging;
+        obj->state.process();
+        std::memcpy(block, obj->staging, remaining * output_size);
+        obj->staged_begin = remaining;
+        obj->staged_count = output_period_count - remaining;
+    }
+
+    obj->io.block = nullptr;
+    return n_samples;
+}
+
+const arrp_kernel kernel =
+{
+    ARRP_KERNEL_ABI_VERSION,
+)";
+    out << "    \"" << nmspace << "\"," << endl;
+    out <<
+R"(    sizeof(kernel_object), alignof(kernel_object),
+    output_size, output_init_count, output_period_count,
+    construct, destruct, initialize, process,
+    reset, process_block
+};
+
+}
+}
+
+extern "C" {
+
+)";
+
+    auto def = [&](const string & ret, const string & name,
+            const string & params, const string & body)
+    {
+        out << "ARRP_KERNEL_EXPORT " << ret << " " << prefix << "_" << name
+            << "(" << params << ")" << endl
+            << "{" << endl << body << "}" << endl << endl;
+    };
+
+    def("const arrp_kernel *", "kernel", "void",
+        "    return &arrp_c_api_detail::kernel;\n");
+    def("size_t", "state_size", "void",
+        "    return sizeof(arrp_c_api_detail::kernel_object);\n");
+    def("size_t", "state_align", "void",
+        "    return alignof(arrp_c_api_detail::kernel_object);\n");
+    def("void", "construct", "void * state",
+        "    arrp_c_api_detail::construct(state, nullptr, nullptr);\n");
+    def("void", "destruct", "void * state",
+        "    arrp_c_api_detail::destruct(state);\n");
+    // Over-allocates to align the state,
+    // storing the allocated address just before it.
+    def("void *", "create", "void",
+        "    using arrp_c_api_detail::kernel_object;\n"
+        "    size_t align = alignof(kernel_object);\n"
+        "    void * raw = std::malloc(sizeof(kernel_object) + align + sizeof(void*));\n"
+        "    if (!raw)\n"
+        "        return nullptr;\n"
+        "    auto addr = reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*);\n"
+        "    addr = (addr + align - 1) & ~std::uintptr_t(align - 1);\n"
+        "    void * state = reinterpret_cast<void*>(addr);\n"
+        "    static_cast<void**>(state)[-1] = raw;\n"
+        "    arrp_c_api_detail::construct(state, nullptr, nullptr);\n"
+        "    return state;\n");
+    def("void", "destroy", "void * state",
+        "    if (!state)\n"
+        "        return;\n"
+        "    arrp_c_api_detail::destruct(state);\n"
+        "    std::free(static_cast<void**>(state)[-1]);\n");
+    def("long", "reset", "void * state, void * const * out",
+        "    return arrp_c_api_detail::reset(state, out);\n");
+    def("long", "process_block",
+        "void * state, const void * const * in, void * const * out, long n_samples",
+        "    return arrp_c_api_detail::process_block(state, in, out, n_samples);\n");
+
+    out << "}" << endl;
+}
+
 }
 }
@@ -86,10 +86,116 @@ inline int size_for(primitive_type pt)
     }
 }
 
+// Name of the state member holding the FFT plan
+// for given transform size and complex result type.
+inline string fft_plan_name(int size, primitive_type pt)
+{
+    return "fft_plan_" + std::to_string(size) +
+            (pt == primitive_type::complex32 ? "f" : "d");
+}
+
+// Properties of generated code useful to hosts.
+struct kernel_info
+{
+    struct channel
+    {
+        primitive_type type = primitive_type::undefined;
+        // Size of data passed in each call, without the streaming dimension.
+        vector<int> size;
+        // Number of calls in initialize() and in each process().
+        int init_count = 0;
+        int period_count = 0;
+    };
+
+    struct buffer_info
+    {
+        string name;
+        primitive_type type;
+        vector<int> size;
+        bool on_stack;
+    };
+
+    channel output;
+    vector<buffer_info> buffers;
+
+    int buffer_bytes(bool on_stack) const;
+
+    // Number of elements passed in each output call.
+    // Scalar streams have an empty size and one element.
+    int output_element_count() const
+    {
+        int count = 1;
+        for (int s : output.size)
+            count *= s;
+        return count;
+    }
+
+    // Bytes passed in each output call.
+    int output_bytes() const
+    {
+        return size_for(output.type) * output_element_count();
+    }
+
+    // Maximum number of outputs computed ahead of request
+    // when processing blocks of arbitrary size.
+    int staging_latency() const
+    {
+        return output.period_count > 0 ? output.period_count - 1 : 0;
+    }
+};
+
+kernel_info describe_kernel(const polyhedral::model &,
+                            const polyhedral::schedule &);
+
+// Writes a JSON descriptor, as read by meta_json::descriptor.
+void write_kernel_info(const string & name, const kernel_info &, ostream &);
+
+struct generator_options
+{
+    // Declare properties as static members of 'state'.
+    const kernel_info * info = nullptr;
+
+    // Count iterations of statements and time loop nests,
+    // see arrp/profile.hpp.
+    bool instrument = false;
+
+    // Emit #line directives mapping statements to Arrp source lines.
+    // Other code is mapped to 'filename', the generated file.
+    bool line_directives = false;
+    string filename;
+};
+
 void generate(const string & name,
               const polyhedral::model & model,
               const polyhedral::ast_isl & ast,
-              ostream & cpp_file);
+              ostream & cpp_file,
+              const generator_options & options = generator_options());
+
+// Generates a program which benchmarks the generated kernel:
+// it times initialization and processing of periods,
+// and reports throughput, per-period latency and state size.
+// With instrumentation, it also prints the profile.
+void generate_benchmark(const string & nmspace,
+                        const string & kernel_filename,
+                        const polyhedral::ast_isl & ast,
+                        ostream & bench_file,
+                        const generator_options & options = generator_options());
+
+// Prefix of C symbols for a kernel in namespace 'nmspace'.
+string c_api_prefix(const string & nmspace);
+
+// Generates C functions which drive the generated kernel:
+// the table in arrp/kernel.h returned by <prefix>_kernel(), and
+// functions to process blocks declared by generate_c_header().
+void generate_c_api(const string & nmspace,
+                    const string & kernel_filename,
+                    const string & header_filename,
+                    const kernel_info & info,
+                    ostream & c_api_file);
+
+void generate_c_header(const string & nmspace,
+                       const kernel_info & info,
+                       ostream & c_header_file);
 
 }
 }
@@ -0,0 +1,331 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_RUNTIME_FFT_INCLUDED
+#define ARRP_RUNTIME_FFT_INCLUDED
+
+/*
+Mixed-radix FFT used by generated code for the fft and ifft primitives.
+
+The transform is a Stockham auto-sort algorithm: every stage reads
+its input with unit stride and writes its output with unit stride,
+so no bit-reversal pass is needed and the inner loops vectorize.
+Sizes are factored into radices 4, 2, 3 and 5; any remaining prime
+factor is handled by a generic (quadratic) butterfly.
+
+A plan is prepared once for a given size (twiddle factors and work
+memory are allocated there), after which forward() and inverse()
+do not allocate.
+*/
+
+#include <complex>
+#include <vector>
+#include <cmath>
+
+namespace arrp {
+
+template <typename T>
+class fft_plan
+{
+public:
+    typedef std::complex<T> complex_type;
+
+    void prepare(int size)
+    {
+        m_size = size;
+        m_stages.clear();
+        m_work.assign(size, complex_type());
+        m_scratch.clear();
+
+        int remaining = size;
+        int span = 1;
+        while (remaining > 1)
+        {
+            int radix = next_radix(remaining);
+            remaining /= radix;
+
+            stage s;
+            s.radix = radix;
+            s.span = span;
+
+            // Twiddles for each position k in span and each butterfly input r.
+            s.twiddles.resize(span * radix);
+            for (int k = 0; k < span; ++k)
+                for (int r = 0; r < radix; ++r)
+                    s.twiddles[k * radix + r] = root(r * k, span * radix);
+
+            // Roots of unity for generic butterflies.
+            if (radix > 5)
+            {
+                s.roots.resize(radix);
+                for (int r = 0; r < radix; ++r)
+                    s.roots[r] = root(r, radix);
+                if ((int) m_scratch.size() < radix)
+                    m_scratch.resize(radix);
+            }
+
+            m_stages.push_back(s);
+            span *= radix;
+        }
+    }
+
+    int size() const { return m_size; }
+
+    template <typename I>
+    void forward(const I * in, complex_type * out)
+    {
+        execute(in, out, false);
+    }
+
+    // The inverse transform is scaled by 1/N,
+    // so that inverse(forward(x)) == x.
+    template <typename I>
+    void inverse(const I * in, complex_type * out)
+    {
+        execute(in, out, true);
+    }
+
+private:
+    struct stage
+    {
+        int radix;
+        int span;
+        std::vector<complex_type> twiddles;
+        std::vector<complex_type> roots;
+    };
+
+    static int next_radix(int n)
+    {
+        if (n % 4 == 0)
+            return 4;
+        if (n % 2 == 0)
+            return 2;
+        if (n % 3 == 0)
+            return 3;
+        if (n % 5 == 0)
+            return 5;
+        for (int p = 7; p * p <= n; p += 2)
+            if (n % p == 0)
+                return p;
+        return n;
+    }
+
+    static complex_type root(int k, int n)
+    {
+        // Computed in double precision to keep twiddles accurate for float plans.
+        double a = -2.0 * 3.14159265358979323846 * (double)(k % n) / (double)n;
+        return complex_type((T)std::cos(a), (T)std::sin(a));
+    }
+
+    template <typename I>
+    static complex_type to_complex(const I & v) { return complex_type(v); }
+
+    template <typename U>
+    static complex_type to_complex(const std::complex<U> & v)
+    {
+        return complex_type((T)v.real(), (T)v.imag());
+    }
+
+    template <typename I>
+    void execute(const I * in, complex_type * out, bool inverse)
+    {
+        const int n = m_size;
+        const int stage_count = (int) m_stages.size();
+
+        // Choose the start buffer so that the last stage writes into out.
+        complex_type * src = (stage_count % 2 == 0) ? out : m_work.data();
+        complex_type * dst = (stage_count % 2 == 0) ? m_work.data() : out;
+
+        if (inverse)
+            for (int i = 0; i < n; ++i)
+                src[i] = std::conj(to_complex(in[i]));
+        else
+            for (int i = 0; i < n; ++i)
+                src[i] = to_complex(in[i]);
+
+        for (const auto & s : m_stages)
+        {
+            switch(s.radix)
+            {
+            case 2: pass2(s, src, dst); break;
+            case 3: pass3(s, src, dst); break;
+            case 4: pass4(s, src, dst); break;
+            case 5: pass5(s, src, dst); break;
+            default: pass_generic(s, src, dst);
+            }
+            std::swap(src, dst);
+        }
+
+        if (inverse)
+        {
+            T scale = T(1) / T(n);
+            for (int i = 0; i < n; ++i)
+                out[i] = std::conj(out[i]) * scale;
+        }
+    }
+
+    /*
+    A stage with radix R and span S reads R inputs spaced N/R apart,
+    multiplies by twiddles, applies an R-point DFT and writes
+    R outputs spaced S apart.
+    */
+
+    void pass2(const stage & s, const complex_type * src, complex_type * dst)
+    {
+        const int m = m_size / 2;
+        const int span = s.span;
+        for (int b = 0; b < m; b += span)
+        {
+            complex_type * out = dst + b * 2;
+            for (int k = 0; k < span; ++k)
+            {
+                const complex_type * w = &s.twiddles[k * 2];
+                complex_type a0 = src[b + k];
+                complex_type a1 = src[b + k + m] * w[1];
+                out[k] = a0 + a1;
+                out[k + span] = a0 - a1;
+            }
+        }
+    }
+
+    void pass3(const stage & s, const complex_type * src, complex_type * dst)
+    {
+        const int m = m_size / 3;
+        const int span = s.span;
+        const T c = T(-0.5);
+        const T d = T(-0.86602540378443864676); // -sin(2 pi / 3)
+        for (int b = 0; b < m; b += span)
+        {
+            complex_type * out = dst + b * 3;
+            for (int k = 0; k < span; ++k)
+            {
+                const complex_type * w = &s.twiddles[k * 3];
+                complex_type a0 = src[b + k];
+                complex_type a1 = src[b + k + m] * w[1];
+                complex_type a2 = src[b + k + 2 * m] * w[2];
+                complex_type t1 = a1 + a2;
+                complex_type t2 = a0 + c * t1;
+                complex_type t3 = (a1 - a2) * d;
+                complex_type jt3(-t3.imag(), t3.real());
+                out[k] = a0 + t1;
+                out[k + span] = t2 + jt3;
+                out[k + 2 * span] = t2 - jt3;
+            }
+        }
+    }
+
+    void pass4(const stage & s, const complex_type * src, complex_type * dst)
+    {
+        const int m = m_size / 4;
+        const int span = s.span;
+        for (int b = 0; b < m; b += span)
+        {
+            complex_type * out = dst + b * 4;
+            for (int k = 0; k < span; ++k)
+            {
+                const complex_type * w = &s.twiddles[k * 4];
+                complex_type a0 = src[b + k];
+                complex_type a1 = src[b + k + m] * w[1];
+                complex_type a2 = src[b + k + 2 * m] * w[2];
+                complex_type a3 = src[b + k + 3 * m] * w[3];
+                complex_type t0 = a0 + a2;
+                complex_type t1 = a0 - a2;
+                complex_type t2 = a1 + a3;
+                complex_type t3 = a1 - a3;
+                // -i * t3
+                complex_type jt3(t3.imag(), -t3.real());
+                out[k] = t0 + t2;
+                out[k + span] = t1 + jt3;
+                out[k + 2 * span] = t0 - t2;
+                out[k + 3 * span] = t1 - jt3;
+            }
+        }
+    }
+
+    void pass5(const stage & s, const complex_type * src, complex_type * dst)
+    {
+        const int m = m_size / 5;
+        const int span = s.span;
+        const T c1 = T(0.30901699437494742410);  // cos(2 pi / 5)
+        const T c2 = T(-0.80901699437494742410); // cos(4 pi / 5)
+        const T s1 = T(-0.95105651629515357212); // -sin(2 pi / 5)
+        const T s2 = T(-0.58778525229247312917); // -sin(4 pi / 5)
+        for (int b = 0; b < m; b += span)
+        {
+            complex_type * out = dst + b * 5;
+            for (int k = 0; k < span; ++k)
+            {
+                const complex_type * w = &s.twiddles[k * 5];
+                complex_type a0 = src[b + k];
+                complex_type a1 = src[b + k + m] * w[1];
+                complex_type a2 = src[b + k + 2 * m] * w[2];
+                complex_type a3 = src[b + k + 3 * m] * w[3];
+                complex_type a4 = src[b + k + 4 * m] * w[4];
+                complex_type p1 = a1 + a4, q1 = a1 - a4;
+                complex_type p2 = a2 + a3, q2 = a2 - a3;
+                complex_type r1 = a0 + c1 * p1 + c2 * p2;
+                complex_type r2 = a0 + c2 * p1 + c1 * p2;
+                complex_type i1 = s1 * q1 + s2 * q2;
+                complex_type i2 = s2 * q1 - s1 * q2;
+                complex_type j1(-i1.imag(), i1.real());
+                complex_type j2(-i2.imag(), i2.real());
+                out[k] = a0 + p1 + p2;
+                out[k + span] = r1 + j1;
+                out[k + 2 * span] = r2 + j2;
+                out[k + 3 * span] = r2 - j2;
+                out[k + 4 * span] = r1 - j1;
+            }
+        }
+    }
+
+    void pass_generic(const stage & s, const complex_type * src, complex_type * dst)
+    {
+        const int radix = s.radix;
+        const int m = m_size / radix;
+        const int span = s.span;
+        complex_type * a = m_scratch.data();
+        for (int b = 0; b < m; b += span)
+        {
+            complex_type * out = dst + b * radix;
+            for (int k = 0; k < span; ++k)
+            {
+                const complex_type * w = &s.twiddles[k * radix];
+                for (int r = 0; r < radix; ++r)
+                    a[r] = src[b + k + r * m] * w[r];
+                for (int q = 0; q < radix; ++q)
+                {
+                    complex_type sum = a[0];
+                    for (int r = 1; r < radix; ++r)
+                        sum += a[r] * s.roots[(r * q) % radix];
+                    out[k + q * span] = sum;
+                }
+            }
+        }
+    }
+
+    int m_size = 0;
+    std::vector<stage> m_stages;
+    std::vector<complex_type> m_work;
+    std::vector<complex_type> m_scratch;
+};
+
+}
+
+#endif // ARRP_RUNTIME_FFT_INCLUDED
@@ -0,0 +1,85 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_KERNEL_H_INCLUDED
+#define ARRP_KERNEL_H_INCLUDED
+
+/*
+C interface of a kernel generated with --c-api.
+
+The generated file <name>_c.cpp exports a function <name>_kernel
+returning a description of the kernel and functions to drive it.
+Non-alphanumeric characters in <name> are replaced by '_'.
+Hosts may link it statically, or build it into a shared library and
+look up the function with dlopen/dlsym (see interface/runtime.hpp).
+
+The host allocates 'state_size' bytes aligned to 'state_align' for the
+state, and calls construct() before and destruct() after use.
+Each output is passed to the output function as a pointer to
+'output_size' bytes.
+*/
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARRP_KERNEL_ABI_VERSION 1
+
+#if defined(_WIN32)
+#define ARRP_KERNEL_EXPORT __declspec(dllexport)
+#else
+#define ARRP_KERNEL_EXPORT __attribute__((visibility("default")))
+#endif
+
+typedef void (*arrp_output_func)(void * user, const void * data);
+
+struct arrp_kernel
+{
+    int abi_version;
+    const char * name;
+
+    size_t state_size;
+    size_t state_align;
+
+    size_t output_size;
+    /* Number of outputs produced by initialize() and by each process(). */
+    int output_init_count;
+    int output_period_count;
+
+    void (*construct)(void * state, arrp_output_func output, void * user);
+    void (*destruct)(void * state);
+    void (*initialize)(void * state);
+    void (*process)(void * state);
+
+    /* Block processing, as declared in the generated <name>_c.h. */
+    long (*reset)(void * state, void * const * out);
+    long (*process_block)(void * state, const void * const * in,
+                          void * const * out, long n_samples);
+};
+
+typedef const struct arrp_kernel * (*arrp_kernel_func)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ARRP_KERNEL_H_INCLUDED */
@@ -0,0 +1,86 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_RUNTIME_KERNELS_INCLUDED
+#define ARRP_RUNTIME_KERNELS_INCLUDED
+
+/*
+Kernels used by generated code for reductions recognized
+by the compiler (option --kernels).
+
+The dot product keeps a block of independent partial sums in
+registers. This breaks the dependency chain of a sequential sum,
+so additions can be pipelined and the unit-stride loop maps onto
+SIMD registers without relying on -ffast-math. As a consequence,
+floating-point results may differ from a sequential sum in the
+last bits.
+*/
+
+namespace arrp {
+
+namespace detail {
+
+template <typename R, typename A, typename B, int W>
+inline R dot_blocked(const A * a, int a_stride, const B * b, int b_stride, int n)
+{
+    R partial[W];
+    for (int j = 0; j < W; ++j)
+        partial[j] = R();
+
+    int i = 0;
+
+    if (a_stride == 1 && b_stride == 1)
+    {
+        for (; i + W <= n; i += W)
+            for (int j = 0; j < W; ++j)
+                partial[j] += R(a[i+j]) * R(b[i+j]);
+    }
+    else
+    {
+        for (; i + W <= n; i += W)
+            for (int j = 0; j < W; ++j)
+                partial[j] += R(a[(i+j) * a_stride]) * R(b[(i+j) * b_stride]);
+    }
+
+    for (; i < n; ++i)
+        partial[0] += R(a[i * a_stride]) * R(b[i * b_stride]);
+
+    // Pairwise combination of partial sums.
+    for (int w = W / 2; w > 0; w /= 2)
+        for (int j = 0; j < w; ++j)
+            partial[j] += partial[j + w];
+
+    return partial[0];
+}
+
+}
+
+// Sum of a[i * a_stride] * b[i * b_stride] for i in [0,n),
+// computed in type R.
+// A stride of 0 repeats a single element.
+template <typename R, typename A, typename B>
+inline R dot(const A * a, int a_stride, const B * b, int b_stride, int n)
+{
+    return detail::dot_blocked<R,A,B,8>(a, a_stride, b, b_stride, n);
+}
+
+}
+
+#endif // ARRP_RUNTIME_KERNELS_INCLUDED
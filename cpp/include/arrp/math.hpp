@@ -0,0 +1,58 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_RUNTIME_MATH_INCLUDED
+#define ARRP_RUNTIME_MATH_INCLUDED
+
+#include <cmath>
+
+/*
+Math functions used by generated code.
+
+sincos computes the sine and cosine of the same argument with
+a single argument reduction, where the C library provides it.
+Results are the same as from separate calls to sin and cos.
+*/
+
+namespace arrp {
+
+inline void sincos(double x, double & s, double & c)
+{
+#if defined(__GLIBC__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_sincos(x, &s, &c);
+#else
+    s = std::sin(x);
+    c = std::cos(x);
+#endif
+}
+
+inline void sincos(float x, float & s, float & c)
+{
+#if defined(__GLIBC__) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_sincosf(x, &s, &c);
+#else
+    s = std::sin(x);
+    c = std::cos(x);
+#endif
+}
+
+}
+
+#endif // ARRP_RUNTIME_MATH_INCLUDED
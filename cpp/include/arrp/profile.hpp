@@ -0,0 +1,186 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_RUNTIME_PROFILE_INCLUDED
+#define ARRP_RUNTIME_PROFILE_INCLUDED
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#define ARRP_PROFILE_TSC 1
+#endif
+
+/*
+Profiling support for code generated with --instrument.
+
+Each outermost loop nest of the generated code is timed,
+and each statement counts its iterations within each loop nest.
+Time of a loop nest is attributed to its statements in proportion
+to their iterations.
+
+Ticks are CPU time stamp counter cycles on x86,
+and nanoseconds elsewhere.
+
+Usage:
+
+  arrp::profile_report report;
+  kernel.profile(report);
+  report.print(std::cout);
+*/
+
+namespace arrp {
+
+inline uint64_t profile_clock()
+{
+#ifdef ARRP_PROFILE_TSC
+    return __rdtsc();
+#else
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct profile_counter
+{
+    uint64_t runs;
+    uint64_t ticks;
+};
+
+inline void profile_record(profile_counter & counter, uint64_t start)
+{
+    counter.ticks += profile_clock() - start;
+    ++counter.runs;
+}
+
+template <typename T, int N>
+inline void profile_clear(T (&counters)[N])
+{
+    std::fill(counters, counters + N, T());
+}
+
+class profile_report
+{
+public:
+    void nest(int index, const profile_counter & counter)
+    {
+        m_nests[index] = counter;
+    }
+
+    // Iterations of a statement within a loop nest.
+    void statement(const char * name, const char * location,
+                   int nest, uint64_t iterations)
+    {
+        auto & stmt = m_statements[name];
+        stmt.location = location;
+        stmt.iterations += iterations;
+        stmt.nest_iterations[nest] += iterations;
+        m_nest_iterations[nest] += iterations;
+    }
+
+    void print(std::ostream & out) const
+    {
+        struct row
+        {
+            std::string name;
+            const statement_info * info;
+            double ticks;
+        };
+
+        std::vector<row> rows;
+        double total_ticks = 0;
+
+        for (auto & nest : m_nests)
+            total_ticks += nest.second.ticks;
+
+        for (auto & stmt : m_statements)
+        {
+            row r { stmt.first, &stmt.second, 0 };
+            for (auto & nest_iter : stmt.second.nest_iterations)
+            {
+                auto nest = m_nests.find(nest_iter.first);
+                auto total_iter = m_nest_iterations.at(nest_iter.first);
+                if (nest == m_nests.end() || total_iter == 0)
+                    continue;
+                r.ticks += double(nest->second.ticks) * nest_iter.second / total_iter;
+            }
+            rows.push_back(r);
+        }
+
+        std::sort(rows.begin(), rows.end(), [](const row & a, const row & b){
+            return a.ticks > b.ticks;
+        });
+
+        auto flags = out.flags();
+        auto precision = out.precision();
+
+        out << std::setw(8) << "% ticks"
+            << std::setw(16) << "ticks"
+            << std::setw(16) << "iterations"
+            << std::setw(12) << "ticks/iter"
+            << "  statement" << std::endl;
+
+        out << std::fixed;
+
+        for (auto & r : rows)
+        {
+            out << std::setprecision(1) << std::setw(8)
+                << (total_ticks > 0 ? 100 * r.ticks / total_ticks : 0.0)
+                << std::setprecision(0) << std::setw(16) << r.ticks
+                << std::setw(16) << r.info->iterations
+                << std::setprecision(2) << std::setw(12)
+                << (r.info->iterations ? r.ticks / r.info->iterations : 0.0)
+                << "  " << r.name;
+            if (*r.info->location)
+                out << " at " << r.info->location;
+            out << std::endl;
+        }
+
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    struct statement_info
+    {
+        const char * location = "";
+        uint64_t iterations = 0;
+        std::map<int, uint64_t> nest_iterations;
+    };
+
+    std::map<int, profile_counter> m_nests;
+    std::map<int, uint64_t> m_nest_iterations;
+    std::map<std::string, statement_info> m_statements;
+};
+
+}
+
+#endif // ARRP_RUNTIME_PROFILE_INCLUDED
@@ -0,0 +1,374 @@
+#include "array_cse.hpp"
+#include "../utility/debug.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+using namespace std;
+
+namespace stream {
+namespace functional {
+
+namespace {
+
+void combine(size_t & seed, size_t value)
+{
+    seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+primitive_type type_of(const expr_ptr & e)
+{
+    if (!e->type || !e->type->is_scalar())
+        return primitive_type::undefined;
+    return e->type->scalar()->primitive;
+}
+
+class reference_redirector : public rewriter_base
+{
+public:
+    reference_redirector(const unordered_map<id_ptr, id_ptr> & targets):
+        m_targets(targets) {}
+
+    expr_ptr visit_ref(const shared_ptr<reference> & ref) override
+    {
+        if (auto id = dynamic_pointer_cast<identifier>(ref->var))
+        {
+            auto target = m_targets.find(id);
+            if (target != m_targets.end())
+                ref->var = target->second;
+        }
+        return ref;
+    }
+
+private:
+    const unordered_map<id_ptr, id_ptr> & m_targets;
+};
+
+}
+
+void array_cse::process(unordered_set<id_ptr> & ids, const id_ptr & output)
+{
+    m_merged.clear();
+
+    // Sorted by name, for deterministic choice of representatives.
+    vector<id_ptr> remaining(ids.begin(), ids.end());
+    std::sort(remaining.begin(), remaining.end(),
+              [](const id_ptr & a, const id_ptr & b){ return a->name < b->name; });
+
+    bool merged_any;
+    do
+    {
+        merged_any = false;
+
+        unordered_map<size_t, vector<id_ptr>> buckets;
+        for (auto & id : remaining)
+            buckets[hash(id->expr)].push_back(id);
+
+        for (auto & id : remaining)
+        {
+            if (m_merged.count(id))
+                continue;
+
+            for (auto & other : buckets[hash(id->expr)])
+            {
+                if (other == id || m_merged.count(other))
+                    continue;
+
+                if (!equal(id->expr, other->expr))
+                    continue;
+
+                // Keep the output array
+                auto kept = id, removed = other;
+                if (removed == output)
+                    std::swap(kept, removed);
+
+                m_merged[removed] = kept;
+                merged_any = true;
+
+                if (verbose<array_cse>::enabled())
+                {
+                    cout << "Merged array " << removed->name
+                         << " into " << kept->name << endl;
+                }
+
+                if (kept != id)
+                    break;
+            }
+        }
+
+        remaining.erase(std::remove_if(remaining.begin(), remaining.end(),
+                                       [&](const id_ptr & id)
+                        { return m_merged.count(id) > 0; }),
+                        remaining.end());
+    }
+    while(merged_any);
+
+    if (m_merged.empty())
+        return;
+
+    unordered_map<id_ptr, id_ptr> targets;
+    for (auto & entry : m_merged)
+        targets[entry.first] = representative(entry.first);
+
+    for (auto & entry : targets)
+        ids.erase(entry.first);
+
+    reference_redirector redirector(targets);
+    for (auto & id : ids)
+        id->expr = redirector.visit(id->expr);
+
+    if (verbose<array_cse>::enabled())
+        cout << "Removed " << targets.size() << " duplicate arrays." << endl;
+}
+
+id_ptr array_cse::representative(const id_ptr & id) const
+{
+    auto result = id;
+    auto it = m_merged.find(result);
+    while (it != m_merged.end())
+    {
+        result = it->second;
+        it = m_merged.find(result);
+    }
+    return result;
+}
+
+size_t array_cse::hash(const expr_ptr & e)
+{
+    size_t h = 0;
+
+    if (!e)
+        return h;
+
+    if (auto c = dynamic_pointer_cast<int_const>(e))
+    {
+        combine(h, 1);
+        combine(h, std::hash<int>()(c->value));
+    }
+    else if (auto c = dynamic_pointer_cast<real_const>(e))
+    {
+        combine(h, 2);
+        combine(h, std::hash<double>()(c->value));
+    }
+    else if (auto c = dynamic_pointer_cast<complex_const>(e))
+    {
+        combine(h, 3);
+        combine(h, std::hash<double>()(c->value.real()));
+        combine(h, std::hash<double>()(c->value.imag()));
+    }
+    else if (auto c = dynamic_pointer_cast<bool_const>(e))
+    {
+        combine(h, 4);
+        combine(h, c->value);
+    }
+    else if (dynamic_pointer_cast<infinity>(e))
+    {
+        combine(h, 5);
+    }
+    else if (auto ref = dynamic_pointer_cast<reference>(e))
+    {
+        combine(h, 6);
+        if (auto id = dynamic_pointer_cast<identifier>(ref->var))
+        {
+            combine(h, std::hash<identifier*>()(representative(id).get()));
+        }
+        else
+        {
+            auto pos = std::find_if(m_vars.begin(), m_vars.end(),
+                                    [&](const pair<var_ptr,var_ptr> & v)
+            { return v.first == ref->var; });
+            if (pos != m_vars.end())
+                combine(h, pos - m_vars.begin());
+            else
+                combine(h, std::hash<var*>()(ref->var.get()));
+        }
+    }
+    else if (dynamic_pointer_cast<array_self_ref>(e))
+    {
+        combine(h, 7);
+    }
+    else if (auto op = dynamic_pointer_cast<primitive>(e))
+    {
+        combine(h, 8);
+        combine(h, (size_t) op->kind);
+        for (auto & operand : op->operands)
+            combine(h, hash(operand));
+    }
+    else if (auto cases = dynamic_pointer_cast<case_expr>(e))
+    {
+        combine(h, 9);
+        for (auto & c : cases->cases)
+        {
+            combine(h, hash(c.first));
+            combine(h, hash(c.second));
+        }
+    }
+    else if (auto arr = dynamic_pointer_cast<array>(e))
+    {
+        combine(h, 10);
+        for (auto & var : arr->vars)
+        {
+            combine(h, hash(var->range));
+            m_vars.emplace_back(var, nullptr);
+        }
+        combine(h, hash(arr->expr));
+        m_vars.resize(m_vars.size() - arr->vars.size());
+    }
+    else if (auto app = dynamic_pointer_cast<array_app>(e))
+    {
+        combine(h, 11);
+        combine(h, hash(app->object));
+        for (auto & arg : app->args)
+            combine(h, hash(arg));
+    }
+    else
+    {
+        // Not compared structurally
+        combine(h, std::hash<expression*>()(e.get()));
+    }
+
+    return h;
+}
+
+bool array_cse::equal(const expr_ptr & a, const expr_ptr & b)
+{
+    if (!a || !b)
+        return !a && !b;
+
+    if (a == b)
+        return true;
+
+    if (type_of(a) != type_of(b))
+        return false;
+
+    if (auto ca = dynamic_pointer_cast<int_const>(a))
+    {
+        auto cb = dynamic_pointer_cast<int_const>(b);
+        return cb && ca->value == cb->value;
+    }
+    else if (auto ca = dynamic_pointer_cast<real_const>(a))
+    {
+        auto cb = dynamic_pointer_cast<real_const>(b);
+        return cb && ca->value == cb->value;
+    }
+    else if (auto ca = dynamic_pointer_cast<complex_const>(a))
+    {
+        auto cb = dynamic_pointer_cast<complex_const>(b);
+        return cb && ca->value == cb->value;
+    }
+    else if (auto ca = dynamic_pointer_cast<bool_const>(a))
+    {
+        auto cb = dynamic_pointer_cast<bool_const>(b);
+        return cb && ca->value == cb->value;
+    }
+    else if (dynamic_pointer_cast<infinity>(a))
+    {
+        return bool(dynamic_pointer_cast<infinity>(b));
+    }
+    else if (auto ra = dynamic_pointer_cast<reference>(a))
+    {
+        auto rb = dynamic_pointer_cast<reference>(b);
+        if (!rb)
+            return false;
+
+        auto id_a = dynamic_pointer_cast<identifier>(ra->var);
+        auto id_b = dynamic_pointer_cast<identifier>(rb->var);
+        if (id_a || id_b)
+        {
+            return id_a && id_b &&
+                    representative(id_a) == representative(id_b);
+        }
+
+        for (auto & v : m_vars)
+        {
+            if (v.first == ra->var || v.second == rb->var)
+                return v.first == ra->var && v.second == rb->var;
+        }
+
+        return ra->var == rb->var;
+    }
+    else if (auto sa = dynamic_pointer_cast<array_self_ref>(a))
+    {
+        auto sb = dynamic_pointer_cast<array_self_ref>(b);
+        if (!sb)
+            return false;
+        for (auto & arrays : m_arrays)
+        {
+            if (arrays.first == sa->arr.get() || arrays.second == sb->arr.get())
+                return arrays.first == sa->arr.get() && arrays.second == sb->arr.get();
+        }
+        return false;
+    }
+    else if (auto pa = dynamic_pointer_cast<primitive>(a))
+    {
+        auto pb = dynamic_pointer_cast<primitive>(b);
+        if (!pb || pa->kind != pb->kind || pa->operands.size() != pb->operands.size())
+            return false;
+        for (int i = 0; i < (int) pa->operands.size(); ++i)
+        {
+            if (!equal(pa->operands[i], pb->operands[i]))
+                return false;
+        }
+        return true;
+    }
+    else if (auto ca = dynamic_pointer_cast<case_expr>(a))
+    {
+        auto cb = dynamic_pointer_cast<case_expr>(b);
+        if (!cb || ca->cases.size() != cb->cases.size())
+            return false;
+        for (int i = 0; i < (int) ca->cases.size(); ++i)
+        {
+            if (!equal(ca->cases[i].first, cb->cases[i].first) ||
+                    !equal(ca->cases[i].second, cb->cases[i].second))
+                return false;
+        }
+        return true;
+    }
+    else if (auto arr_a = dynamic_pointer_cast<array>(a))
+    {
+        auto arr_b = dynamic_pointer_cast<array>(b);
+        if (!arr_b || arr_a->vars.size() != arr_b->vars.size())
+            return false;
+
+        // Local definitions should have been reduced.
+        if (!arr_a->scope.ids.empty() || !arr_b->scope.ids.empty())
+            return false;
+
+        for (int i = 0; i < (int) arr_a->vars.size(); ++i)
+        {
+            if (!equal(arr_a->vars[i]->range, arr_b->vars[i]->range))
+                return false;
+        }
+
+        for (int i = 0; i < (int) arr_a->vars.size(); ++i)
+            m_vars.emplace_back(arr_a->vars[i], arr_b->vars[i]);
+        m_arrays.emplace_back(arr_a.get(), arr_b.get());
+
+        bool result = equal(arr_a->expr, arr_b->expr);
+
+        m_vars.resize(m_vars.size() - arr_a->vars.size());
+        m_arrays.pop_back();
+
+        return result;
+    }
+    else if (auto app_a = dynamic_pointer_cast<array_app>(a))
+    {
+        auto app_b = dynamic_pointer_cast<array_app>(b);
+        if (!app_b || app_a->args.size() != app_b->args.size())
+            return false;
+        if (!equal(app_a->object, app_b->object))
+            return false;
+        for (int i = 0; i < (int) app_a->args.size(); ++i)
+        {
+            if (!equal(app_a->args[i], app_b->args[i]))
+                return false;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+}
+}
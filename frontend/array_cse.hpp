@@ -0,0 +1,53 @@
+#ifndef STREAM_LANG_ARRAY_CSE_INCLUDED
+#define STREAM_LANG_ARRAY_CSE_INCLUDED
+
+#include "../common/functional_model.hpp"
+#include "../common/func_model_visitor.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace stream {
+namespace functional {
+
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+/*
+Merges reduced arrays which are defined by the same expression
+over the same domain, up to renaming of array variables.
+Function inlining creates such duplicates when a function is
+applied to the same arguments in different places.
+
+References to a removed array are redirected to the array it was
+merged into. Merging is repeated until no more duplicates are found,
+so arrays which only differ in references to merged arrays
+are merged as well.
+*/
+
+class array_cse
+{
+public:
+    // The array 'output' is never removed.
+    void process(unordered_set<id_ptr> & ids, const id_ptr & output);
+
+private:
+    id_ptr representative(const id_ptr &) const;
+
+    size_t hash(const expr_ptr &);
+    bool equal(const expr_ptr &, const expr_ptr &);
+
+    unordered_map<id_ptr, id_ptr> m_merged;
+
+    // Array variables and arrays of the arrays being compared,
+    // from outermost to innermost.
+    vector<pair<var_ptr, var_ptr>> m_vars;
+    vector<pair<array*, array*>> m_arrays;
+};
+
+}
+}
+
+#endif // STREAM_LANG_ARRAY_CSE_INCLUDED
@@ -0,0 +1,416 @@
+#include "array_inlining.hpp"
+#include "func_copy.hpp"
+#include "name_provider.hpp"
+#include "../common/func_model_printer.hpp"
+#include "../utility/debug.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace stream {
+namespace functional {
+
+namespace {
+
+// Costs in units of a simple arithmetic operation.
+// Storing or loading an array element costs 1.
+const int cheap_op_cost = 1;
+const int division_cost = 4;
+const int function_cost = 16;
+
+int cost(const expr_ptr & e)
+{
+    if (!e)
+        return 0;
+
+    if (auto op = dynamic_pointer_cast<primitive>(e))
+    {
+        int c = 0;
+        for (auto & operand : op->operands)
+            c += cost(operand);
+
+        switch(op->kind)
+        {
+        case primitive_op::divide:
+        case primitive_op::divide_integer:
+        case primitive_op::modulo:
+        case primitive_op::sqrt:
+            return c + division_cost;
+        case primitive_op::raise:
+        case primitive_op::exp:
+        case primitive_op::exp2:
+        case primitive_op::log:
+        case primitive_op::log2:
+        case primitive_op::log10:
+        case primitive_op::sin:
+        case primitive_op::cos:
+        case primitive_op::tan:
+        case primitive_op::asin:
+        case primitive_op::acos:
+        case primitive_op::atan:
+            return c + function_cost;
+        default:
+            return c + cheap_op_cost;
+        }
+    }
+    else if (auto app = dynamic_pointer_cast<array_app>(e))
+    {
+        int c = 1;
+        for (auto & arg : app->args)
+            c += cost(arg);
+        return c;
+    }
+
+    return 0;
+}
+
+// Whether an expression can be moved into another array:
+// no cases, nested arrays or recursion.
+class movability_check : public visitor<void>
+{
+public:
+    bool movable = true;
+
+    void visit_cases(const shared_ptr<case_expr> &) override { movable = false; }
+    void visit_array(const shared_ptr<array> &) override { movable = false; }
+    void visit_array_self_ref(const shared_ptr<array_self_ref> &) override { movable = false; }
+    void visit_array_patterns(const shared_ptr<array_patterns> &) override { movable = false; }
+    void visit_operation(const shared_ptr<operation> &) override { movable = false; }
+    void visit_array_size(const shared_ptr<array_size> &) override { movable = false; }
+    void visit_func_app(const shared_ptr<func_app> &) override { movable = false; }
+    void visit_func(const shared_ptr<function> &) override { movable = false; }
+    void visit_affine(const shared_ptr<affine_expr> &) override { movable = false; }
+};
+
+// Adds coefficients of array variables in an integer expression.
+// Returns false if the expression is not linear in array variables.
+bool linear_coefficients(const expr_ptr & e, int scale,
+                         unordered_map<array_var*, int> & coefs)
+{
+    if (dynamic_pointer_cast<int_const>(e))
+    {
+        return true;
+    }
+    else if (auto ref = dynamic_pointer_cast<reference>(e))
+    {
+        auto var = dynamic_pointer_cast<array_var>(ref->var);
+        if (!var)
+            return false;
+        coefs[var.get()] += scale;
+        return true;
+    }
+    else if (auto op = dynamic_pointer_cast<primitive>(e))
+    {
+        switch(op->kind)
+        {
+        case primitive_op::add:
+            return linear_coefficients(op->operands[0], scale, coefs) &&
+                    linear_coefficients(op->operands[1], scale, coefs);
+        case primitive_op::subtract:
+            return linear_coefficients(op->operands[0], scale, coefs) &&
+                    linear_coefficients(op->operands[1], -scale, coefs);
+        case primitive_op::negate:
+            return linear_coefficients(op->operands[0], -scale, coefs);
+        case primitive_op::multiply:
+        {
+            auto c = dynamic_pointer_cast<int_const>(op->operands[0].expr);
+            auto other = op->operands[1].expr;
+            if (!c)
+            {
+                c = dynamic_pointer_cast<int_const>(op->operands[1].expr);
+                other = op->operands[0].expr;
+            }
+            if (!c)
+                return false;
+            return linear_coefficients(other, scale * c->value, coefs);
+        }
+        default:
+            return false;
+        }
+    }
+
+    return false;
+}
+
+// Whether each element read by 'app' is read for at most one
+// element of the reading array.
+bool reads_distinct_elements(const shared_ptr<array_app> & app,
+                             const vector<array_var_ptr> & reader_vars)
+{
+    unordered_set<array_var*> used_vars;
+
+    for (auto & arg : app->args)
+    {
+        unordered_map<array_var*, int> coefs;
+        if (!linear_coefficients(arg, 1, coefs))
+            return false;
+
+        int var_count = 0;
+        for (auto & coef : coefs)
+        {
+            if (coef.second == 0)
+                continue;
+            if (++var_count > 1)
+                return false;
+            if (!used_vars.insert(coef.first).second)
+                return false;
+        }
+    }
+
+    for (auto & var : reader_vars)
+    {
+        if (!used_vars.count(var.get()))
+            return false;
+    }
+
+    return true;
+}
+
+// Copies an expression, replacing references to array variables
+// with copies of the bound expressions.
+class var_substitution : public copier
+{
+public:
+    var_substitution(unordered_set<id_ptr> & ids, name_provider & names,
+                     const unordered_map<var*, expr_ptr> & bindings):
+        copier(ids, names), m_bindings(bindings) {}
+
+protected:
+    expr_ptr visit_ref(const shared_ptr<reference> & ref) override
+    {
+        auto binding = m_bindings.find(ref->var.get());
+        if (binding != m_bindings.end())
+            return copy(binding->second);
+        return copier::visit_ref(ref);
+    }
+
+private:
+    const unordered_map<var*, expr_ptr> & m_bindings;
+};
+
+class read_replacer : public rewriter_base
+{
+public:
+    read_replacer(const unordered_map<array_app*, expr_ptr> & replacements):
+        m_replacements(replacements) {}
+
+    expr_ptr visit_array_app(const shared_ptr<array_app> & app) override
+    {
+        auto replacement = m_replacements.find(app.get());
+        if (replacement != m_replacements.end())
+            return replacement->second;
+        return rewriter_base::visit_array_app(app);
+    }
+
+private:
+    const unordered_map<array_app*, expr_ptr> & m_replacements;
+};
+
+}
+
+void array_inliner::process(unordered_set<id_ptr> & ids, const id_ptr & output)
+{
+    // Sorted by name, for deterministic results.
+    vector<id_ptr> sorted_ids(ids.begin(), ids.end());
+    std::sort(sorted_ids.begin(), sorted_ids.end(),
+              [](const id_ptr & a, const id_ptr & b){ return a->name < b->name; });
+
+    bool inlined_any;
+    do
+    {
+        inlined_any = false;
+
+        find_uses(ids);
+
+        // Arrays read by an inlined array have new reads,
+        // so they are reconsidered in the next round.
+        unordered_set<identifier*> changed;
+
+        for (auto & id : sorted_ids)
+        {
+            if (!ids.count(id) || changed.count(id.get()))
+                continue;
+
+            if (!is_candidate(id, output) || !is_profitable(id))
+                continue;
+
+            for (auto & entry : m_uses)
+            {
+                for (auto & site : entry.second.sites)
+                {
+                    if (site.reader == id)
+                        changed.insert(entry.first);
+                }
+            }
+
+            inline_array(id);
+            ids.erase(id);
+            inlined_any = true;
+        }
+    }
+    while(inlined_any);
+
+    if (verbose<array_inliner>::enabled())
+        cout << "Inlined " << m_count << " arrays." << endl;
+}
+
+void array_inliner::find_uses(const unordered_set<id_ptr> & ids)
+{
+    class finder : public visitor<void>
+    {
+    public:
+        finder(unordered_map<identifier*, usage> & uses): uses(uses) {}
+
+        void visit_ref(const shared_ptr<reference> & ref) override
+        {
+            // Any reference other than an element read.
+            if (auto id = dynamic_pointer_cast<identifier>(ref->var))
+                uses[id.get()].blocked = true;
+        }
+
+        void visit_array_app(const shared_ptr<array_app> & app) override
+        {
+            auto ref = dynamic_pointer_cast<reference>(app->object.expr);
+            auto id = ref ? dynamic_pointer_cast<identifier>(ref->var) : nullptr;
+            if (!id)
+            {
+                visitor<void>::visit_array_app(app);
+                return;
+            }
+
+            auto & use = uses[id.get()];
+            if (reader_vars && reads_distinct_elements(app, *reader_vars))
+                use.sites.push_back({ reader, app });
+            else
+                use.blocked = true;
+
+            for (auto & arg : app->args)
+                visit(arg);
+        }
+
+        unordered_map<identifier*, usage> & uses;
+        id_ptr reader;
+        const vector<array_var_ptr> * reader_vars = nullptr;
+    };
+
+    m_uses.clear();
+
+    finder f(m_uses);
+
+    for (auto & id : ids)
+    {
+        static const vector<array_var_ptr> no_vars;
+
+        f.reader = id;
+        f.reader_vars = &no_vars;
+
+        expr_ptr expr = id->expr;
+        if (auto arr = dynamic_pointer_cast<array>(expr))
+        {
+            if (arr->is_recursive || id->is_recursive)
+                f.reader_vars = nullptr;
+            else
+                f.reader_vars = &arr->vars;
+            expr = arr->expr;
+        }
+        else if (id->is_recursive)
+        {
+            f.reader_vars = nullptr;
+        }
+
+        f.visit(expr);
+    }
+}
+
+bool array_inliner::is_candidate(const id_ptr & id, const id_ptr & output)
+{
+    if (id == output || id->is_recursive)
+        return false;
+
+    auto arr = dynamic_pointer_cast<array>(id->expr.expr);
+    if (!arr || arr->is_recursive || !arr->scope.ids.empty())
+        return false;
+
+    movability_check check;
+    check.visit(arr->expr);
+    if (!check.movable)
+        return false;
+
+    auto use = m_uses.find(id.get());
+    if (use == m_uses.end())
+        return false;
+
+    if (use->second.blocked || use->second.sites.empty())
+        return false;
+
+    for (auto & site : use->second.sites)
+    {
+        if (site.app->args.size() != arr->vars.size())
+            return false;
+    }
+
+    return true;
+}
+
+bool array_inliner::is_profitable(const id_ptr & id)
+{
+    auto arr = dynamic_pointer_cast<array>(id->expr.expr);
+
+    int reads = m_uses[id.get()].sites.size();
+
+    // Each element is computed once per read instead of once,
+    // but it is not stored and loaded.
+    int extra_work = (reads - 1) * cost(arr->expr);
+    int saved_work = 1 + reads;
+
+    return extra_work <= saved_work;
+}
+
+void array_inliner::inline_array(const id_ptr & id)
+{
+    auto arr = dynamic_pointer_cast<array>(id->expr.expr);
+    auto & sites = m_uses[id.get()].sites;
+
+    unordered_set<id_ptr> copied_ids;
+    name_provider names(':');
+
+    unordered_map<identifier*, unordered_map<array_app*, expr_ptr>> replacements;
+
+    for (auto & site : sites)
+    {
+        unordered_map<var*, expr_ptr> bindings;
+        for (int i = 0; i < (int) arr->vars.size(); ++i)
+            bindings[arr->vars[i].get()] = site.app->args[i];
+
+        var_substitution sub(copied_ids, names, bindings);
+        auto expr = sub.copy(arr->expr.expr);
+        expr->location = site.app->location;
+
+        replacements[site.reader.get()][site.app.get()] = expr;
+    }
+
+    for (auto & site : sites)
+    {
+        auto reader_replacements = replacements.find(site.reader.get());
+        if (reader_replacements == replacements.end())
+            continue;
+
+        read_replacer replacer(reader_replacements->second);
+        site.reader->expr = replacer.visit(site.reader->expr);
+
+        replacements.erase(reader_replacements);
+    }
+
+    ++m_count;
+
+    if (verbose<array_inliner>::enabled())
+    {
+        cout << "Inlined array " << id->name
+             << " into " << sites.size() << " reads." << endl;
+    }
+}
+
+}
+}
@@ -0,0 +1,70 @@
+#ifndef STREAM_LANG_ARRAY_INLINING_INCLUDED
+#define STREAM_LANG_ARRAY_INLINING_INCLUDED
+
+#include "../common/functional_model.hpp"
+#include "../common/func_model_visitor.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace stream {
+namespace functional {
+
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
+
+/*
+Substitutes the definition of cheap reduced arrays into the
+expressions which read them, so that they do not become separate
+statements with their own storage.
+
+An array is inlined when:
+- It is not recursive and not the output, and is defined by a single
+  expression (not by cases or an array transform).
+- All its uses are reads of single elements.
+- No element is read more than once by the same read expression:
+  each index depends on at most one variable of the reading array,
+  and each such variable is used by exactly one index.
+- Recomputing an element at each of its reads costs no more than
+  storing it and loading it at each read.
+
+Arrays are not inlined into recursive arrays, so that reductions
+keep the form recognized by kernel mapping.
+*/
+
+class array_inliner
+{
+public:
+    // The array 'output' is never removed.
+    void process(unordered_set<id_ptr> & ids, const id_ptr & output);
+
+    int inlined_count() const { return m_count; }
+
+private:
+    struct read_site
+    {
+        id_ptr reader;
+        shared_ptr<array_app> app;
+    };
+
+    struct usage
+    {
+        vector<read_site> sites;
+        bool blocked = false;
+    };
+
+    void find_uses(const unordered_set<id_ptr> & ids);
+    bool is_candidate(const id_ptr &, const id_ptr & output);
+    bool is_profitable(const id_ptr &);
+    void inline_array(const id_ptr &);
+
+    unordered_map<identifier*, usage> m_uses;
+    int m_count = 0;
+};
+
+}
+}
+
+#endif // STREAM_LANG_ARRAY_INLINING_INCLUDED
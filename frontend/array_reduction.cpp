@@ -498,6 +498,9 @@ expr_ptr array_reducer::reduce(std::shared_ptr<array_app> app)
 
 expr_ptr array_reducer::reduce(std::shared_ptr<primitive> op)
 {
+    if (is_array_transform(op->kind))
+        return reduce_array_transform(op);
+
     for (auto & operand : op->operands)
         operand = reduce(operand);
 
@@ -568,6 +571,52 @@ expr_ptr array_reducer::reduce(std::shared_ptr<primitive> op)
     return arr;
 }
 
+expr_ptr array_reducer::reduce_array_transform(std::shared_ptr<primitive> op)
+{
+    // The operand is transformed as a whole, so it can not be
+    // reduced pointwise. Store it and the result in separate arrays.
+
+    auto & operand = op->operands[0];
+
+    bool is_id_ref = false;
+    if (auto ref = dynamic_pointer_cast<reference>(operand.expr))
+        is_id_ref = bool(dynamic_pointer_cast<identifier>(ref->var));
+
+    if (!is_id_ref)
+    {
+        auto name = m_name_provider.new_name("tmp");
+        auto id = make_shared<identifier>(name, operand.expr, location_type());
+        operand = make_ref(id);
+    }
+
+    // Process id and detect free vars in substitution,
+    // by reducing the reference:
+    operand = reduce(operand);
+
+    if (!dynamic_pointer_cast<reference>(operand.expr))
+    {
+        ostringstream msg;
+        msg << "Operand of " << op->kind
+            << " depends on variables of an enclosing array.";
+        throw source_error(msg.str(), op->location);
+    }
+
+    auto name = m_name_provider.new_name(name_of_primitive(op->kind));
+    auto id = make_shared<identifier>(name, op, op->location);
+
+    if (verbose<array_reducer>::enabled())
+    {
+        cout << "Storing array transform: ";
+        m_printer.print(id, cout);
+        cout << endl;
+    }
+
+    m_processed_ids.insert(id);
+    m_final_ids.insert(id);
+
+    return make_ref(id);
+}
+
 expr_ptr array_reducer::reduce(std::shared_ptr<operation> op)
 {
     for (auto & operand : op->operands)
@@ -59,6 +59,7 @@ private:
     expr_ptr reduce(std::shared_ptr<array>, std::shared_ptr<array_patterns>);
     expr_ptr reduce(std::shared_ptr<array_app>);
     expr_ptr reduce(std::shared_ptr<primitive>);
+    expr_ptr reduce_array_transform(std::shared_ptr<primitive>);
     expr_ptr reduce(std::shared_ptr<operation>);
     expr_ptr reduce(std::shared_ptr<case_expr>);
     expr_ptr reduce(std::shared_ptr<reference>);
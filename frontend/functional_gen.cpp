@@ -32,6 +32,8 @@ unordered_map<string, primitive_op> generator::m_prim_ops =
     { "real64", primitive_op::to_real64 },
     { "complex32", primitive_op::to_complex32 },
     { "complex64", primitive_op::to_complex64 },
+    { "fft", primitive_op::fft },
+    { "ifft", primitive_op::ifft },
 };
 
 source_error generator::module_error(const string & what, const parsing::location & loc)
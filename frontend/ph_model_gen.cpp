@@ -116,14 +116,27 @@ ph::array_ptr polyhedral_gen::make_array(id_ptr id)
 {
     string array_name = id->name;
 
-    vector<array_var_ptr> vars;
+    vector<int> extents;
     if (auto arr = dynamic_pointer_cast<functional::array>(id->expr.expr))
-        vars = arr->vars;
+    {
+        for (auto & var : arr->vars)
+        {
+            if (auto c = dynamic_pointer_cast<constant<int>>(var->range.expr))
+                extents.push_back(c->value);
+            else
+                extents.push_back(-1);
+        }
+    }
+    else if (auto ar_type = dynamic_pointer_cast<array_type>(id->expr->type))
+    {
+        // Result of an array transform
+        extents = ar_type->size;
+    }
 
     auto arr = make_shared<ph::array>();
 
     auto tuple = isl::set_tuple( isl::identifier(array_name, arr.get()),
-                                 std::max((int)vars.size(), 1) );
+                                 std::max((int)extents.size(), 1) );
 
     auto space = isl::space( m_isl_ctx, tuple );
     auto domain = isl::set::universe(space);
@@ -131,17 +144,12 @@ ph::array_ptr polyhedral_gen::make_array(id_ptr id)
     bool is_infinite = false;
     vector<int> size;
 
-    if (!vars.empty())
+    if (!extents.empty())
     {
-        for (int dim = 0; dim < (int)vars.size(); ++dim)
+        for (int dim = 0; dim < (int)extents.size(); ++dim)
         {
-            auto var = vars[dim];
-            int extent = -1;
-            if (auto c = dynamic_pointer_cast<constant<int>>(var->range.expr))
-            {
-                extent = c->value;
-            }
-            else
+            int extent = extents[dim];
+            if (extent < 0)
             {
                 if (dim != 0)
                 {
@@ -212,6 +220,16 @@ void polyhedral_gen::make_statements(id_ptr id, ph::model & output)
 
     string stmt_name = id->name + ".s";
 
+    if (auto prim = dynamic_pointer_cast<primitive>(id->expr.expr))
+    {
+        if (is_array_transform(prim->kind))
+        {
+            auto s = make_transform_stmt(id, stmt_name, prim);
+            output.statements.push_back(s);
+            return;
+        }
+    }
+
     if (auto arr = dynamic_pointer_cast<functional::array>(id->expr.expr))
     {
         if (auto case_expr = dynamic_pointer_cast<functional::case_expr>(arr->expr.expr))
@@ -349,6 +367,76 @@ polyhedral::stmt_ptr polyhedral_gen::make_stmt
     return stmt;
 }
 
+polyhedral::stmt_ptr polyhedral_gen::make_transform_stmt
+(id_ptr id, const string & name, std::shared_ptr<primitive> transform)
+{
+    auto out_array = m_arrays.at(id);
+
+    auto operand = dynamic_pointer_cast<reference>(transform->operands[0].expr);
+    assert(operand);
+    auto operand_id = dynamic_pointer_cast<identifier>(operand->var);
+    assert(operand_id);
+    auto in_array = m_arrays.at(operand_id);
+
+    // One statement instance per row.
+
+    int row_dims = (int) out_array->size.size() - 1;
+
+    auto tuple = isl::set_tuple( isl::identifier(name, nullptr),
+                                 std::max(row_dims, 1) );
+    auto space = isl::space(m_isl_ctx, tuple);
+    auto domain = isl::set::universe(space);
+    auto lspace = isl::local_space(space);
+
+    if (row_dims == 0)
+    {
+        domain.add_constraint(lspace(isl::space::variable, 0) == 0);
+    }
+
+    for (int dim = 0; dim < row_dims; ++dim)
+    {
+        auto index = lspace(isl::space::variable, dim);
+        domain.add_constraint(index >= 0);
+        if (out_array->size[dim] >= 0)
+            domain.add_constraint(index < out_array->size[dim]);
+    }
+
+    auto stmt = make_shared<ph::statement>(domain);
+    stmt->is_infinite = out_array->is_infinite;
+
+    // Each instance reads and writes an entire row,
+    // so relations only constrain the leading dimensions.
+
+    auto row_relation = [&](const ph::array_ptr & array)
+    {
+        auto s = isl::space::from(stmt->domain.get_space(),
+                                  array->domain.get_space());
+        auto m = isl::multi_expression::zero(s, row_dims);
+        for (int d = 0; d < row_dims; ++d)
+            m.set(d, s.in(d));
+        return ph::array_relation(array, m);
+    };
+
+    stmt->write_relation = row_relation(out_array);
+    stmt->read_relations.push_back(row_relation(in_array));
+
+    auto call = make_shared<ph::transform_call>(transform->location);
+    call->kind = transform->kind;
+    call->input = in_array;
+    call->size = out_array->size.back();
+    call->type = make_shared<scalar_type>(out_array->type);
+
+    stmt->expr = call;
+
+    if (my_verbose_out::enabled())
+    {
+        cout << "Transform statement domain:" << endl;
+        m_isl_printer.print(stmt->domain); cout << endl;
+    }
+
+    return stmt;
+}
+
 expr_ptr polyhedral_gen::visit_ref(const shared_ptr<reference> & ref)
 {
     if (auto av = dynamic_pointer_cast<array_var>(ref->var))
@@ -60,6 +60,10 @@ private:
                                    expr_ptr subdomain_expr,
                                    expr_ptr expr);
 
+    polyhedral::stmt_ptr make_transform_stmt(id_ptr id,
+                                             const string & name,
+                                             std::shared_ptr<primitive> transform);
+
     isl::set to_affine_set(expr_ptr, const space_map &);
     isl::expression to_affine_expr(expr_ptr, const space_map &);
 
@@ -0,0 +1,764 @@
+#include "simplification.hpp"
+#include "../common/func_model_printer.hpp"
+#include "../utility/debug.hpp"
+
+#include <cmath>
+#include <climits>
+#include <complex>
+#include <iostream>
+
+using namespace std;
+
+namespace stream {
+namespace functional {
+
+namespace {
+
+// Larger powers are left to pow().
+const int max_expanded_power = 4;
+
+primitive_type type_of(const expr_ptr & e)
+{
+    if (!e || !e->type || !e->type->is_scalar())
+        return primitive_type::undefined;
+    return e->type->scalar()->primitive;
+}
+
+bool is_real(primitive_type t)
+{
+    return t == primitive_type::real32 || t == primitive_type::real64;
+}
+
+bool is_number(const expr_ptr & e)
+{
+    return dynamic_cast<int_const*>(e.get()) ||
+            dynamic_cast<real_const*>(e.get());
+}
+
+double number(const expr_ptr & e)
+{
+    if (auto i = dynamic_cast<int_const*>(e.get()))
+        return i->value;
+    if (auto r = dynamic_cast<real_const*>(e.get()))
+        return r->value;
+    return 0;
+}
+
+bool is_value(const expr_ptr & e, double v)
+{
+    return is_number(e) && number(e) == v;
+}
+
+bool is_conversion(primitive_op op)
+{
+    switch(op)
+    {
+    case primitive_op::to_real32:
+    case primitive_op::to_real64:
+    case primitive_op::to_complex32:
+    case primitive_op::to_complex64:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Does conversion from one type to another preserve every value?
+bool is_exact_conversion(primitive_type from, primitive_type to)
+{
+    using pt = primitive_type;
+
+    if (from == to)
+        return true;
+
+    switch(to)
+    {
+    case pt::real64:
+        return from == pt::integer || from == pt::real32;
+    case pt::complex32:
+        return from == pt::real32;
+    case pt::complex64:
+        return from == pt::integer || from == pt::real32 ||
+                from == pt::real64 || from == pt::complex32;
+    default:
+        return false;
+    }
+}
+
+type_ptr constant_type(primitive_type t)
+{
+    auto s = make_shared<scalar_type>(t);
+    s->constant_flag = true;
+    s->affine_flag = t == primitive_type::integer || is_real(t);
+    s->data_flag = true;
+    return s;
+}
+
+expr_ptr make_constant(double v, primitive_type t, const location_type & loc)
+{
+    using pt = primitive_type;
+
+    switch(t)
+    {
+    case pt::integer:
+        return make_shared<int_const>((int) v, loc);
+    case pt::real32:
+        return make_shared<real_const>((double)(float) v, loc, constant_type(t));
+    case pt::real64:
+        return make_shared<real_const>(v, loc, constant_type(t));
+    case pt::complex32:
+        return make_shared<complex_const>(complex<double>((float) v, 0), loc, constant_type(t));
+    case pt::complex64:
+        return make_shared<complex_const>(complex<double>(v, 0), loc, constant_type(t));
+    case pt::boolean:
+        return make_shared<bool_const>(v != 0, loc, constant_type(t));
+    default:
+        return nullptr;
+    }
+}
+
+shared_ptr<primitive> make_primitive(primitive_op kind,
+                                     const vector<expr_ptr> & operands,
+                                     const type_ptr & type,
+                                     const location_type & loc)
+{
+    auto result = make_shared<primitive>(kind, operands);
+    result->type = type;
+    result->location = loc;
+    return result;
+}
+
+// Copy of an expression, for expressions which are cheap to repeat.
+// Leaves are shared, because they are not modified by later passes.
+expr_ptr duplicate(const expr_ptr & e)
+{
+    if (is_number(e) ||
+            dynamic_cast<reference*>(e.get()) ||
+            dynamic_cast<array_self_ref*>(e.get()))
+    {
+        return e;
+    }
+    else if (auto op = dynamic_cast<primitive*>(e.get()))
+    {
+        switch(op->kind)
+        {
+        case primitive_op::negate:
+        case primitive_op::add:
+        case primitive_op::subtract:
+        case primitive_op::multiply:
+        case primitive_op::to_real32:
+        case primitive_op::to_real64:
+        case primitive_op::to_complex32:
+        case primitive_op::to_complex64:
+            break;
+        default:
+            return nullptr;
+        }
+
+        vector<expr_ptr> operands;
+        for (auto & operand : op->operands)
+        {
+            auto copy = duplicate(operand);
+            if (!copy)
+                return nullptr;
+            operands.push_back(copy);
+        }
+
+        return make_primitive(op->kind, operands, op->type, op->location);
+    }
+    else if (auto app = dynamic_cast<array_app*>(e.get()))
+    {
+        auto copy = make_shared<array_app>();
+        copy->object = app->object;
+        copy->location = app->location;
+        copy->type = app->type;
+        for (auto & arg : app->args)
+        {
+            auto arg_copy = duplicate(arg);
+            if (!arg_copy)
+                return nullptr;
+            copy->args.emplace_back(arg_copy, arg.location);
+        }
+        return copy;
+    }
+
+    return nullptr;
+}
+
+bool fold_int(primitive_op op, const vector<long long> & a, long long & r)
+{
+    switch(op)
+    {
+    case primitive_op::negate:
+        r = -a[0]; break;
+    case primitive_op::add:
+        r = a[0] + a[1]; break;
+    case primitive_op::subtract:
+        r = a[0] - a[1]; break;
+    case primitive_op::multiply:
+        r = a[0] * a[1]; break;
+    case primitive_op::divide_integer:
+    case primitive_op::modulo:
+        // Only where all definitions of integer division agree.
+        if (a[0] < 0 || a[1] <= 0)
+            return false;
+        r = op == primitive_op::modulo ? a[0] % a[1] : a[0] / a[1];
+        break;
+    case primitive_op::raise:
+    {
+        if (a[1] < 0)
+            return false;
+        // By squaring, so huge exponents of 0 and 1 are cheap.
+        // Factors stay within int range, so products fit in long long.
+        long long base = a[0];
+        long long exp = a[1];
+        r = 1;
+        while (exp > 0)
+        {
+            if (exp & 1)
+            {
+                r *= base;
+                if (r > INT_MAX || r < INT_MIN)
+                    return false;
+            }
+            exp >>= 1;
+            if (exp > 0)
+            {
+                base *= base;
+                // The remaining bits multiply r by at least 'base'.
+                if (base > INT_MAX)
+                    return false;
+            }
+        }
+        break;
+    }
+    case primitive_op::abs:
+        r = a[0] < 0 ? -a[0] : a[0]; break;
+    case primitive_op::min:
+        r = std::min(a[0], a[1]); break;
+    case primitive_op::max:
+        r = std::max(a[0], a[1]); break;
+    case primitive_op::floor:
+    case primitive_op::ceil:
+        r = a[0]; break;
+    default:
+        return false;
+    }
+
+    return r <= INT_MAX && r >= INT_MIN;
+}
+
+template <typename T>
+bool fold_real(primitive_op op, const vector<T> & a, T & r)
+{
+    switch(op)
+    {
+    case primitive_op::negate:
+        r = -a[0]; break;
+    case primitive_op::add:
+        r = a[0] + a[1]; break;
+    case primitive_op::subtract:
+        r = a[0] - a[1]; break;
+    case primitive_op::multiply:
+        r = a[0] * a[1]; break;
+    case primitive_op::divide:
+        r = a[0] / a[1]; break;
+    case primitive_op::raise:
+        r = std::pow(a[0], a[1]); break;
+    case primitive_op::exp:
+        r = std::exp(a[0]); break;
+    case primitive_op::exp2:
+        r = std::exp2(a[0]); break;
+    case primitive_op::log:
+        r = std::log(a[0]); break;
+    case primitive_op::log2:
+        r = std::log2(a[0]); break;
+    case primitive_op::log10:
+        r = std::log10(a[0]); break;
+    case primitive_op::sqrt:
+        r = std::sqrt(a[0]); break;
+    case primitive_op::sin:
+        r = std::sin(a[0]); break;
+    case primitive_op::cos:
+        r = std::cos(a[0]); break;
+    case primitive_op::tan:
+        r = std::tan(a[0]); break;
+    case primitive_op::asin:
+        r = std::asin(a[0]); break;
+    case primitive_op::acos:
+        r = std::acos(a[0]); break;
+    case primitive_op::atan:
+        r = std::atan(a[0]); break;
+    case primitive_op::abs:
+        r = std::abs(a[0]); break;
+    case primitive_op::min:
+        r = std::min(a[0], a[1]); break;
+    case primitive_op::max:
+        r = std::max(a[0], a[1]); break;
+    case primitive_op::to_real32:
+    case primitive_op::to_real64:
+        r = a[0]; break;
+    default:
+        return false;
+    }
+
+    // Leave division by zero and domain errors to run time.
+    return std::isfinite(r);
+}
+
+bool fold_comparison(primitive_op op, double a, double b, bool & r)
+{
+    switch(op)
+    {
+    case primitive_op::compare_eq:
+        r = a == b; break;
+    case primitive_op::compare_neq:
+        r = a != b; break;
+    case primitive_op::compare_l:
+        r = a < b; break;
+    case primitive_op::compare_g:
+        r = a > b; break;
+    case primitive_op::compare_leq:
+        r = a <= b; break;
+    case primitive_op::compare_geq:
+        r = a >= b; break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+}
+
+void simplifier::process(unordered_set<id_ptr> & ids)
+{
+    m_count = 0;
+
+    for (auto & id : ids)
+        id->expr = visit(id->expr);
+
+    if (verbose<simplifier>::enabled())
+        cout << "Simplified " << m_count << " expressions." << endl;
+}
+
+expr_ptr simplifier::visit_cases(const shared_ptr<case_expr> & e)
+{
+    for (auto & c : e->cases)
+        c.second = visit(c.second);
+    return e;
+}
+
+expr_ptr simplifier::visit_primitive(const shared_ptr<primitive> & op)
+{
+    rewriter_base::visit_primitive(op);
+
+    auto result = simplify(op);
+    if (!result)
+        return op;
+
+    ++m_count;
+
+    if (verbose<simplifier>::enabled())
+    {
+        functional::printer printer;
+        cout << "Simplified ";
+        printer.print(op, cout);
+        cout << " -> ";
+        printer.print(result, cout);
+        cout << endl;
+    }
+
+    return result;
+}
+
+// Returns a replacement for the expression, or null.
+expr_ptr simplifier::simplify(const shared_ptr<primitive> & op)
+{
+    auto t = type_of(op);
+    if (t == primitive_type::undefined || t == primitive_type::infinity)
+        return nullptr;
+
+    if (is_array_transform(op->kind))
+        return nullptr;
+
+    if (auto result = fold(op))
+        return result;
+
+    if (is_conversion(op->kind))
+        return simplify_conversion(op);
+
+    return simplify_arithmetic(op);
+}
+
+expr_ptr simplifier::fold(const shared_ptr<primitive> & op)
+{
+    using pt = primitive_type;
+
+    auto r_t = type_of(op);
+    auto & a = op->operands;
+
+    switch(op->kind)
+    {
+    case primitive_op::conditional:
+    {
+        auto c = dynamic_cast<bool_const*>(a[0].expr.get());
+        if (!c)
+            return nullptr;
+        return convert(c->value ? a[1].expr : a[2].expr, op->type);
+    }
+    case primitive_op::logic_and:
+    case primitive_op::logic_or:
+    {
+        bool is_and = op->kind == primitive_op::logic_and;
+        for (int k = 0; k < 2; ++k)
+        {
+            auto c = dynamic_cast<bool_const*>(a[k].expr.get());
+            if (!c)
+                continue;
+            if (c->value == is_and)
+                return a[1-k];
+            else
+                return make_constant(!is_and, pt::boolean, op->location);
+        }
+        return nullptr;
+    }
+    case primitive_op::negate:
+    {
+        if (auto c = dynamic_cast<bool_const*>(a[0].expr.get()))
+            return make_constant(!c->value, pt::boolean, op->location);
+        break;
+    }
+    default:
+        break;
+    }
+
+    bool all_int = true;
+    for (auto & operand : a)
+    {
+        if (!is_number(operand))
+            return nullptr;
+        if (type_of(operand) != pt::integer)
+            all_int = false;
+    }
+
+    switch(r_t)
+    {
+    case pt::integer:
+    {
+        if (!all_int)
+        {
+            if (op->kind != primitive_op::floor && op->kind != primitive_op::ceil)
+                return nullptr;
+            double v = number(a[0]);
+            v = op->kind == primitive_op::floor ? std::floor(v) : std::ceil(v);
+            if (v > INT_MAX || v < INT_MIN)
+                return nullptr;
+            return make_constant(v, r_t, op->location);
+        }
+
+        vector<long long> args;
+        for (auto & operand : a)
+            args.push_back((long long) number(operand));
+        long long r;
+        if (!fold_int(op->kind, args, r))
+            return nullptr;
+        return make_constant((double) r, r_t, op->location);
+    }
+    case pt::real32:
+    {
+        vector<float> args;
+        for (auto & operand : a)
+            args.push_back((float) number(operand));
+        float r;
+        if (!fold_real(op->kind, args, r))
+            return nullptr;
+        return make_constant(r, r_t, op->location);
+    }
+    case pt::real64:
+    {
+        vector<double> args;
+        for (auto & operand : a)
+            args.push_back(number(operand));
+        double r;
+        if (!fold_real(op->kind, args, r))
+            return nullptr;
+        return make_constant(r, r_t, op->location);
+    }
+    case pt::complex32:
+    case pt::complex64:
+    {
+        if (op->kind != primitive_op::to_complex32 &&
+                op->kind != primitive_op::to_complex64)
+            return nullptr;
+        return make_constant(number(a[0]), r_t, op->location);
+    }
+    case pt::boolean:
+    {
+        if (a.size() != 2)
+            return nullptr;
+        bool r;
+        if (!fold_comparison(op->kind, number(a[0]), number(a[1]), r))
+            return nullptr;
+        return make_constant(r, r_t, op->location);
+    }
+    default:
+        return nullptr;
+    }
+}
+
+expr_ptr simplifier::simplify_conversion(const shared_ptr<primitive> & op)
+{
+    auto r_t = type_of(op);
+    auto operand = op->operands[0].expr;
+
+    // Skip intermediate conversions which preserve the value.
+    while (auto inner = dynamic_cast<primitive*>(operand.get()))
+    {
+        if (!is_conversion(inner->kind))
+            break;
+        auto & source = inner->operands[0].expr;
+        if (!is_exact_conversion(type_of(source), type_of(operand)))
+            break;
+        operand = source;
+    }
+
+    if (type_of(operand) == r_t)
+        return operand;
+
+    if (operand == op->operands[0].expr)
+        return nullptr;
+
+    return make_primitive(op->kind, { operand }, op->type, op->location);
+}
+
+expr_ptr simplifier::simplify_arithmetic(const shared_ptr<primitive> & op)
+{
+    auto r_t = type_of(op);
+    bool is_int = r_t == primitive_type::integer;
+
+    auto & a = op->operands;
+
+    auto negated = [&](const expr_ptr & e) -> expr_ptr
+    {
+        auto x = convert(e, op->type);
+        if (!x)
+            return nullptr;
+        return make_primitive(primitive_op::negate, { x }, op->type, op->location);
+    };
+
+    switch(op->kind)
+    {
+    case primitive_op::add:
+    {
+        // For reals, x+0 is not exact for x = -0.
+        if (!is_int)
+            break;
+        if (is_value(a[0], 0))
+            return convert(a[1], op->type);
+        if (is_value(a[1], 0))
+            return convert(a[0], op->type);
+        break;
+    }
+    case primitive_op::subtract:
+    {
+        if (is_value(a[1], 0))
+            return convert(a[0], op->type);
+        if (is_int && is_value(a[0], 0))
+            return negated(a[1]);
+        break;
+    }
+    case primitive_op::multiply:
+    {
+        for (int k = 0; k < 2; ++k)
+        {
+            if (is_value(a[k], 1))
+                return convert(a[1-k], op->type);
+            if (is_value(a[k], -1))
+                return negated(a[1-k]);
+            if (is_int && is_value(a[k], 0))
+                return make_constant(0, r_t, op->location);
+        }
+        break;
+    }
+    case primitive_op::divide:
+    {
+        if (is_value(a[1], 1))
+            return convert(a[0], op->type);
+        return reciprocal(op);
+    }
+    case primitive_op::divide_integer:
+    {
+        if (type_of(a[0]) == primitive_type::integer && is_value(a[1], 1))
+            return a[0];
+        break;
+    }
+    case primitive_op::modulo:
+    {
+        if (is_value(a[1], 1))
+            return make_constant(0, r_t, op->location);
+        break;
+    }
+    case primitive_op::negate:
+    {
+        auto inner = dynamic_cast<primitive*>(a[0].expr.get());
+        if (inner && inner->kind == primitive_op::negate)
+            return convert(inner->operands[0], op->type);
+        break;
+    }
+    case primitive_op::raise:
+    {
+        return expand_power(op);
+    }
+    default:
+        break;
+    }
+
+    return nullptr;
+}
+
+expr_ptr simplifier::expand_power(const shared_ptr<primitive> & op)
+{
+    auto r_t = type_of(op);
+    auto & base = op->operands[0].expr;
+    auto & exponent = op->operands[1].expr;
+
+    if (!is_number(exponent))
+        return nullptr;
+
+    double e = number(exponent);
+    if (e != std::floor(e) || std::abs(e) > max_expanded_power)
+        return nullptr;
+
+    int n = (int) e;
+
+    // pow(x,0) is 1 even for infinity and NaN.
+    if (n == 0)
+        return make_constant(1, r_t, op->location);
+
+    if (n == 1)
+        return convert(base, op->type);
+
+    // x*x and 1/x are rounded once, like pow(x,2) and pow(x,-1).
+    // Other real and complex powers accumulate rounding errors.
+    if (!m_relaxed_float && r_t != primitive_type::integer && n != 2 && n != -1)
+        return nullptr;
+
+    if (n < 0 && !is_real(r_t))
+        return nullptr;
+
+    auto x = convert(base, op->type);
+    if (!x)
+        return nullptr;
+
+    expr_ptr result = x;
+    for (int i = 1; i < std::abs(n); ++i)
+    {
+        auto factor = duplicate(x);
+        if (!factor)
+            return nullptr;
+        result = make_primitive(primitive_op::multiply, { result, factor },
+                                op->type, op->location);
+    }
+
+    if (n < 0)
+    {
+        auto one = make_constant(1, r_t, op->location);
+        result = make_primitive(primitive_op::divide, { one, result },
+                                op->type, op->location);
+    }
+
+    return result;
+}
+
+expr_ptr simplifier::reciprocal(const shared_ptr<primitive> & op)
+{
+    using pt = primitive_type;
+
+    auto r_t = type_of(op);
+    auto & divisor = op->operands[1].expr;
+
+    if (!is_number(divisor))
+        return nullptr;
+
+    pt component;
+    switch(r_t)
+    {
+    case pt::real32:
+    case pt::complex32:
+        component = pt::real32; break;
+    case pt::real64:
+    case pt::complex64:
+        component = pt::real64; break;
+    default:
+        return nullptr;
+    }
+
+    double c = number(divisor);
+    if (c == 0 || !std::isfinite(c))
+        return nullptr;
+
+    double r = 1.0 / c;
+
+    // The reciprocal of a power of two is exact,
+    // unless it is out of the normal range.
+    int exp;
+    bool is_exact = std::abs(std::frexp(c, &exp)) == 0.5;
+    if (component == pt::real32)
+        is_exact = is_exact && std::isnormal((float) r) && (float) c == c;
+    else
+        is_exact = is_exact && std::isnormal(r);
+
+    if (!is_exact && !m_relaxed_float)
+        return nullptr;
+
+    auto factor = make_constant(r, component, divisor->location);
+    return make_primitive(primitive_op::multiply, { op->operands[0].expr, factor },
+                          op->type, op->location);
+}
+
+expr_ptr simplifier::convert(const expr_ptr & e, const type_ptr & type)
+{
+    using pt = primitive_type;
+
+    if (!e || !type || !type->is_scalar())
+        return nullptr;
+
+    auto from = type_of(e);
+    auto to = type->scalar()->primitive;
+
+    if (from == to)
+        return e;
+
+    if (from == pt::undefined || from == pt::boolean || from == pt::infinity)
+        return nullptr;
+
+    primitive_op kind;
+    switch(to)
+    {
+    case pt::real32:
+        kind = primitive_op::to_real32; break;
+    case pt::real64:
+        kind = primitive_op::to_real64; break;
+    case pt::complex32:
+        kind = primitive_op::to_complex32; break;
+    case pt::complex64:
+        kind = primitive_op::to_complex64; break;
+    default:
+        return nullptr;
+    }
+
+    if (is_complex(from) && !is_complex(to))
+        return nullptr;
+
+    auto result = make_primitive(kind, { e }, type, e->location);
+
+    if (auto folded = fold(result))
+        return folded;
+    if (auto simplified = simplify_conversion(result))
+        return simplified;
+
+    return result;
+}
+
+}
+}
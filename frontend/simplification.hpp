@@ -0,0 +1,62 @@
+#ifndef STREAM_LANG_SIMPLIFICATION_INCLUDED
+#define STREAM_LANG_SIMPLIFICATION_INCLUDED
+
+#include "../common/functional_model.hpp"
+#include "../common/func_model_visitor.hpp"
+
+#include <unordered_set>
+
+namespace stream {
+namespace functional {
+
+using std::unordered_set;
+
+/*
+Algebraic simplification of reduced arrays:
+- Folds operations on constants.
+- Removes identities: x+0, x-0, x*1, x/1, x^1, -(-x), conversions
+  to the same type and exact intermediate conversions.
+- Replaces annihilated integer expressions: x*0, x%1.
+- Expands small integer powers into multiplications.
+- Replaces division by a constant with multiplication by its reciprocal.
+
+Floating-point rewrites are only applied when the result is exactly
+the same, so x+0 is kept for reals (it turns -0 into +0).
+With relaxed_float, rewrites which may change the last bits of a result
+are also applied: any reciprocal, and powers other than 2 and -1.
+
+Domain constraints of array cases are left untouched,
+since they must remain affine.
+*/
+
+class simplifier : public rewriter_base
+{
+public:
+    simplifier(bool relaxed_float = false):
+        m_relaxed_float(relaxed_float) {}
+
+    void process(unordered_set<id_ptr> & ids);
+
+    int simplification_count() const { return m_count; }
+
+protected:
+    virtual expr_ptr visit_primitive(const shared_ptr<primitive> &) override;
+    virtual expr_ptr visit_cases(const shared_ptr<case_expr> &) override;
+
+private:
+    expr_ptr simplify(const shared_ptr<primitive> &);
+    expr_ptr fold(const shared_ptr<primitive> &);
+    expr_ptr simplify_conversion(const shared_ptr<primitive> &);
+    expr_ptr simplify_arithmetic(const shared_ptr<primitive> &);
+    expr_ptr expand_power(const shared_ptr<primitive> &);
+    expr_ptr reciprocal(const shared_ptr<primitive> &);
+    expr_ptr convert(const expr_ptr &, const type_ptr &);
+
+    bool m_relaxed_float;
+    int m_count = 0;
+};
+
+}
+}
+
+#endif // STREAM_LANG_SIMPLIFICATION_INCLUDED
@@ -191,6 +191,9 @@ type_ptr type_checker::visit_ref(const shared_ptr<reference> & ref)
 
 type_ptr type_checker::visit_primitive(const shared_ptr<primitive> & prim)
 {
+    if (is_array_transform(prim->kind))
+        return process_array_transform(prim);
+
     array_size_vec common_size;
     vector<primitive_type> elem_types;
     vector<type_ptr> operand_types;
@@ -301,6 +304,73 @@ type_ptr type_checker::visit_primitive(const shared_ptr<primitive> & prim)
     }
 }
 
+type_ptr type_checker::process_array_transform(const shared_ptr<primitive> & prim)
+{
+    if (prim->operands.size() != 1)
+    {
+        ostringstream msg;
+        msg << "Operation " << prim->kind << " takes 1 operand.";
+        throw type_error(msg.str(), prim->location);
+    }
+
+    auto & operand = prim->operands[0];
+
+    auto type = visit(operand);
+
+    auto arr = dynamic_pointer_cast<array_type>(type);
+    if (!arr)
+    {
+        ostringstream msg;
+        msg << "Operand of " << prim->kind << " is not an array.";
+        throw type_error(msg.str(), operand.location);
+    }
+
+    // The last dimension is transformed, the others are independent rows.
+    // Only the first dimension may be unbounded, so that rows
+    // are not reordered by array transposition.
+
+    for (int dim = 1; dim < (int) arr->size.size(); ++dim)
+    {
+        if (arr->size[dim] == array_var::unconstrained)
+        {
+            ostringstream msg;
+            msg << "Operand of " << prim->kind
+                << " is unbounded in dimension " << (dim+1) << ".";
+            throw type_error(msg.str(), operand.location);
+        }
+    }
+
+    if (arr->size.back() == array_var::unconstrained)
+    {
+        ostringstream msg;
+        msg << "Operand of " << prim->kind
+            << " is unbounded in the transformed dimension.";
+        throw type_error(msg.str(), operand.location);
+    }
+
+    vector<primitive_type> elem_types = { arr->element };
+
+    primitive_type result_elem_type;
+
+    try {
+        result_elem_type = result_type(prim->kind, elem_types);
+    }
+    catch (no_type &)
+    {
+        string msg("Invalid operand types: ");
+        msg += text(prim->kind, elem_types);
+        throw type_error(msg, prim->location);
+    }
+    catch (ambiguous_type &)
+    {
+        string msg("Ambiguous type resolution:");
+        msg += text(prim->kind, elem_types);
+        throw type_error(msg, prim->location);
+    }
+
+    return make_shared<array_type>(arr->size, result_elem_type);
+}
+
 type_ptr type_checker::visit_operation(const shared_ptr<operation> & op)
 {
     switch(op->kind)
@@ -32,6 +32,7 @@ private:
     type_ptr visit_infinity(const shared_ptr<infinity> &) override;
     type_ptr visit_ref(const shared_ptr<reference> &) override;
     type_ptr visit_primitive(const shared_ptr<primitive> & prim) override;
+    type_ptr process_array_transform(const shared_ptr<primitive> & prim);
     type_ptr visit_operation(const shared_ptr<operation> &) override;
     type_ptr process_array_concat(const shared_ptr<operation> &);
     type_ptr process_array_enum(const shared_ptr<operation> &);
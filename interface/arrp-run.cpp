@@ -0,0 +1,165 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+// Runs a kernel loaded at run time, writing its raw output
+// to a file or standard output, e.g. a pipe.
+
+#include "runtime.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+using namespace stream::runtime;
+
+static void print_usage(const char * program)
+{
+    cerr << "Usage: " << program << " <kernel library>"
+         << " [--descriptor <file>] [--periods <n>] [--output <file>] [--time]"
+         << endl
+         << "  --descriptor  Kernel descriptor. Default: the library path"
+            " without 'lib' prefix and with extension '.json'." << endl
+         << "  --periods     Number of periods to run. Default: until output fails." << endl
+         << "  --output      Output file or '-' for standard output (default)." << endl
+         << "  --time        Print throughput to standard error." << endl;
+}
+
+static string default_descriptor_path(const string & library_path)
+{
+    string dir, base = library_path;
+
+    auto sep_pos = base.find_last_of("/\\");
+    if (sep_pos != string::npos)
+    {
+        dir = base.substr(0, sep_pos + 1);
+        base = base.substr(sep_pos + 1);
+    }
+
+    auto dot_pos = base.find('.');
+    if (dot_pos != string::npos)
+        base = base.substr(0, dot_pos);
+
+    if (base.compare(0, 3, "lib") == 0 && base.size() > 3)
+        base = base.substr(3);
+
+    return dir + base + ".json";
+}
+
+int main(int argc, char * argv[])
+{
+    string library_path;
+    string descriptor_path;
+    string output_path = "-";
+    long periods = -1;
+    bool time = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--descriptor" && i + 1 < argc)
+            descriptor_path = argv[++i];
+        else if (arg == "--periods" && i + 1 < argc)
+            periods = atol(argv[++i]);
+        else if (arg == "--output" && i + 1 < argc)
+            output_path = argv[++i];
+        else if (arg == "--time")
+            time = true;
+        else if (library_path.empty() && arg[0] != '-')
+            library_path = arg;
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (library_path.empty())
+    {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    if (descriptor_path.empty())
+        descriptor_path = default_descriptor_path(library_path);
+
+    FILE * out = stdout;
+    if (output_path != "-")
+    {
+        out = fopen(output_path.c_str(), "wb");
+        if (!out)
+        {
+            cerr << "Failed to open output file: " << output_path << endl;
+            return 1;
+        }
+    }
+
+    try
+    {
+        stream::runtime::kernel k(library_path, descriptor_path);
+
+        bool ok = true;
+        long outputs = 0;
+
+        auto sink = [&](const void * data, int count)
+        {
+            outputs += count;
+            if (fwrite(data, k.output_size(), count, out) != (size_t) count)
+                ok = false;
+        };
+
+        auto start = chrono::steady_clock::now();
+
+        k.initialize(sink);
+
+        long p = 0;
+        if (k.api().output_period_count > 0)
+        {
+            for (; ok && (periods < 0 || p < periods); ++p)
+                k.process(sink);
+        }
+
+        auto end = chrono::steady_clock::now();
+
+        if (time)
+        {
+            double s = chrono::duration<double>(end - start).count();
+            cerr << "Periods: " << p << ", outputs: " << outputs
+                 << ", time: " << s << " s";
+            if (s > 0)
+                cerr << ", " << outputs / s << " outputs/s";
+            cerr << endl;
+        }
+    }
+    catch (stream::runtime::kernel::error & e)
+    {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (out != stdout)
+        fclose(out);
+    else
+        fflush(out);
+
+    return 0;
+}
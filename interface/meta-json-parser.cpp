@@ -35,6 +35,8 @@ numerical_type parse_type(const JSON::Value & data)
         return integer;
     else if (type_str == "real")
         return real;
+    else if (type_str == "complex")
+        return complex;
     else
         throw read_error("Invalid numerical type: " + type_str);
 }
@@ -96,6 +98,12 @@ descriptor descriptor::from_file(const string &filename)
     if (doc.type() != JSON::OBJECT)
         throw read_error("Doc not an object.");
 
+    // Name
+
+    JSON::Value name = doc["name"];
+    if (name.type() == JSON::STRING)
+        d.name = name.as_string();
+
     // Inputs
 
     JSON::Value inputs = doc["inputs"];
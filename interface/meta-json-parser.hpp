@@ -18,6 +18,7 @@ along with this program; if not, write to the Free Software Foundation, Inc.,
 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
 */
 
+#include <complex>
 #include <cstdint>
 #include <vector>
 #include <string>
@@ -30,7 +31,8 @@ using std::string;
 
 enum numerical_type {
     integer,
-    real
+    real,
+    complex
 };
 
 template<numerical_type>
@@ -38,6 +40,7 @@ struct represent;
 
 template<> struct represent<integer> { typedef int type; };
 template<> struct represent<real> { typedef double type; };
+template<> struct represent<complex> { typedef std::complex<double> type; };
 
 struct buffer
 {
@@ -66,6 +69,8 @@ struct descriptor
         string what;
     };
 
+    // Name of the generated namespace, if known.
+    string name;
     vector<channel> inputs;
     channel output;
     vector<buffer> buffers;
@@ -93,6 +98,9 @@ public:
             case real:
                 data = new double[buffer_info.size];
                 break;
+            case complex:
+                data = new std::complex<double>[buffer_info.size];
+                break;
             }
             m_buffers.push_back(buffer{data, 0});
         }
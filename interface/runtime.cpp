@@ -0,0 +1,136 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "runtime.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+
+namespace stream {
+namespace runtime {
+
+kernel::kernel(const string & library_path, const string & descriptor_path)
+{
+    try {
+        m_descriptor = meta_json::descriptor::from_file(descriptor_path);
+    }
+    catch (meta_json::descriptor::read_error & e)
+    {
+        throw error("Failed to read kernel descriptor " + descriptor_path
+                    + ": " + e.what);
+    }
+
+    if (m_descriptor.name.empty())
+        throw error("Kernel descriptor has no name: " + descriptor_path);
+
+    if (!m_descriptor.inputs.empty())
+        throw error("Kernels with inputs are not supported.");
+
+    m_library = dlopen(library_path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!m_library)
+        throw error("Failed to load kernel library: " + string(dlerror()));
+
+    string symbol = m_descriptor.name + "_kernel";
+    for (auto & c : symbol)
+    {
+        if (!isalnum((unsigned char) c))
+            c = '_';
+    }
+    auto get_api = reinterpret_cast<arrp_kernel_func>(dlsym(m_library, symbol.c_str()));
+    if (!get_api)
+    {
+        dlclose(m_library);
+        throw error("Kernel library does not define " + symbol + ".");
+    }
+
+    m_api = get_api();
+
+    string mismatch;
+    if (m_api->abi_version != ARRP_KERNEL_ABI_VERSION)
+        mismatch = "ABI version";
+    else if (m_api->output_init_count != m_descriptor.output.init_count ||
+             m_api->output_period_count != m_descriptor.output.period_count)
+        mismatch = "output rate";
+    if (!mismatch.empty())
+    {
+        dlclose(m_library);
+        throw error("Kernel library and descriptor differ in " + mismatch + ".");
+    }
+
+    size_t align = std::max(m_api->state_align, sizeof(void*));
+    if (posix_memalign(&m_state, align, std::max<size_t>(m_api->state_size, 1)) != 0)
+    {
+        dlclose(m_library);
+        throw error("Failed to allocate kernel state.");
+    }
+
+    int max_count = std::max(m_api->output_init_count, m_api->output_period_count);
+    m_block.reserve(max_count * m_api->output_size);
+}
+
+kernel::~kernel()
+{
+    if (m_constructed)
+        m_api->destruct(m_state);
+    free(m_state);
+    dlclose(m_library);
+}
+
+void kernel::initialize(const output_sink & sink)
+{
+    if (m_constructed)
+        m_api->destruct(m_state);
+    m_api->construct(m_state, &kernel::receive, this);
+    m_constructed = true;
+
+    m_api->initialize(m_state);
+    flush(sink);
+}
+
+void kernel::process(const output_sink & sink)
+{
+    if (!m_constructed)
+        throw error("Kernel not initialized.");
+
+    m_api->process(m_state);
+    flush(sink);
+}
+
+void kernel::receive(void * user, const void * data)
+{
+    auto k = reinterpret_cast<kernel*>(user);
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    k->m_block.insert(k->m_block.end(), bytes, bytes + k->m_api->output_size);
+    ++k->m_block_count;
+}
+
+void kernel::flush(const output_sink & sink)
+{
+    if (m_block_count && sink)
+        sink(m_block.data(), m_block_count);
+    m_block.clear();
+    m_block_count = 0;
+}
+
+}
+}
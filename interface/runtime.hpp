@@ -0,0 +1,89 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef ARRP_RUNTIME_INCLUDED
+#define ARRP_RUNTIME_INCLUDED
+
+#include "meta-json-parser.hpp"
+
+#include <arrp/kernel.h>
+
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace stream {
+namespace runtime {
+
+using std::string;
+using std::vector;
+
+// Receives a block of outputs: 'count' consecutive outputs
+// of kernel::output_size() bytes each.
+using output_sink = std::function<void(const void * data, int count)>;
+
+// A kernel compiled with --c-api into a shared library,
+// loaded at run time along with its JSON descriptor.
+class kernel
+{
+public:
+    struct error : public std::runtime_error
+    {
+        error(const string & what): std::runtime_error(what) {}
+    };
+
+    // Loads the library and allocates the kernel state.
+    // The name of the kernel is taken from the descriptor.
+    kernel(const string & library_path, const string & descriptor_path);
+    ~kernel();
+
+    kernel(const kernel &) = delete;
+    kernel & operator=(const kernel &) = delete;
+
+    const meta_json::descriptor & descriptor() const { return m_descriptor; }
+    const arrp_kernel & api() const { return *m_api; }
+
+    int output_size() const { return m_api->output_size; }
+
+    // Constructs the state anew and runs initialize().
+    void initialize(const output_sink &);
+
+    // Runs one period.
+    void process(const output_sink &);
+
+private:
+    static void receive(void * user, const void * data);
+    void flush(const output_sink &);
+
+    meta_json::descriptor m_descriptor;
+    void * m_library = nullptr;
+    const arrp_kernel * m_api = nullptr;
+    void * m_state = nullptr;
+    bool m_constructed = false;
+    vector<unsigned char> m_block;
+    int m_block_count = 0;
+};
+
+}
+}
+
+#endif // ARRP_RUNTIME_INCLUDED
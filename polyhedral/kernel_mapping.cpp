@@ -0,0 +1,326 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "kernel_mapping.hpp"
+#include "../utility/debug.hpp"
+
+#include <isl-cpp/printer.hpp>
+#include <isl/map.h>
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+namespace stream {
+namespace polyhedral {
+
+struct dot_match
+{
+    stmt_ptr init;
+    stmt_ptr step;
+    shared_ptr<array_read> lhs;
+    shared_ptr<array_read> rhs;
+};
+
+// Does the relation map each statement instance
+// to the previous element along the last array dimension?
+static bool is_previous_element(const stmt_ptr & stmt, const array_relation & rel)
+{
+    int last = rel.array->domain.dimensions() - 1;
+
+    auto space = isl::space::from(stmt->domain.get_space(),
+                                  rel.array->domain.get_space());
+    auto expected = isl::basic_map::universe(space);
+    for (int d = 0; d < last; ++d)
+        expected.add_constraint(space.out(d) == space.in(d));
+    expected.add_constraint(space.out(last) == space.in(last) - 1);
+
+    isl::map actual = to_isl_map(stmt, rel);
+    isl::map expected_map = expected;
+    return isl_map_is_equal(actual.get(), expected_map.get()) == isl_bool_true;
+}
+
+static bool has_compatible_types(const array_ptr & result, const dot_match & match)
+{
+    auto t = result->type;
+    auto lhs_t = match.lhs->array->type;
+    auto rhs_t = match.rhs->array->type;
+
+    if (t == primitive_type::boolean ||
+            lhs_t == primitive_type::boolean ||
+            rhs_t == primitive_type::boolean)
+        return false;
+
+    // Mixed complex and real products need conversions
+    // which the kernel does not do.
+    if (is_complex(t) || is_complex(lhs_t) || is_complex(rhs_t))
+        return lhs_t == t && rhs_t == t;
+
+    return true;
+}
+
+static bool match_dot_product(const model & m, const array_ptr & array, dot_match & match)
+{
+    if (array->size.empty())
+        return false;
+
+    int last = (int) array->size.size() - 1;
+    int n = array->size[last];
+    if (n < 2)
+        return false;
+
+    vector<stmt_ptr> writers;
+    for (auto & stmt : m.statements)
+    {
+        if (stmt->write_relation.array == array)
+            writers.push_back(stmt);
+    }
+    if (writers.size() != 2)
+        return false;
+
+    // Identify the initial and the accumulating statement by their domains.
+
+    {
+        auto array_domain = array->domain;
+        array_domain.clear_id();
+        auto i = array_domain.get_space().var(last);
+
+        auto first_domain = array_domain;
+        first_domain.add_constraint(i == 0);
+
+        auto rest_domain = array_domain;
+        rest_domain.add_constraint(i >= 1);
+
+        for (auto & stmt : writers)
+        {
+            auto domain = stmt->domain;
+            domain.clear_id();
+            if (domain == first_domain)
+                match.init = stmt;
+            else if (domain == rest_domain)
+                match.step = stmt;
+        }
+
+        if (!match.init || !match.step)
+            return false;
+    }
+
+    for (auto & rel : match.init->read_relations)
+    {
+        if (rel.array == array)
+            return false;
+    }
+
+    // Accumulating statement must be: a * b + previous
+
+    {
+        auto sum = dynamic_pointer_cast<functional::primitive>(match.step->expr);
+        if (!sum || sum->kind != primitive_op::add)
+            return false;
+
+        shared_ptr<functional::primitive> product;
+        shared_ptr<array_read> previous;
+        for (int k = 0; k < 2; ++k)
+        {
+            product = dynamic_pointer_cast<functional::primitive>(sum->operands[k].expr);
+            previous = dynamic_pointer_cast<array_read>(sum->operands[1-k].expr);
+            if (product && previous)
+                break;
+        }
+
+        if (!product || !previous || product->kind != primitive_op::multiply)
+            return false;
+
+        if (previous->array != array || !previous->relation ||
+                !is_previous_element(match.step, *previous->relation))
+            return false;
+
+        match.lhs = dynamic_pointer_cast<array_read>(product->operands[0].expr);
+        match.rhs = dynamic_pointer_cast<array_read>(product->operands[1].expr);
+        if (!match.lhs || !match.rhs)
+            return false;
+        if (match.lhs->array == array || match.rhs->array == array)
+            return false;
+    }
+
+    if (!has_compatible_types(array, match))
+        return false;
+
+    // All other readers must only read the last element of each row.
+
+    auto last_elements = array->domain;
+    last_elements.add_constraint(last_elements.get_space().var(last) == n - 1);
+
+    for (auto & stmt : m.statements)
+    {
+        if (stmt == match.step)
+            continue;
+
+        for (auto & rel : stmt->read_relations)
+        {
+            if (rel.array != array)
+                continue;
+
+            isl::map access = to_isl_map(stmt, rel);
+            access = isl_map_intersect_domain(access.copy(), stmt->domain.copy());
+            auto elements = access.range();
+            if (isl_set_is_subset(elements.get(), last_elements.get()) != isl_bool_true)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+static void update_relation_pointers
+(const functional::expr_ptr & expr,
+ const unordered_map<array_relation*, array_relation*> & moved)
+{
+    if (auto read = dynamic_pointer_cast<array_read>(expr))
+    {
+        auto it = moved.find(read->relation);
+        read->relation = it != moved.end() ? it->second : nullptr;
+    }
+    else if (auto prim = dynamic_pointer_cast<functional::primitive>(expr))
+    {
+        for (auto & operand : prim->operands)
+            update_relation_pointers(operand, moved);
+    }
+    else if (auto call = dynamic_pointer_cast<external_call>(expr))
+    {
+        for (auto & arg : call->args)
+            update_relation_pointers(arg, moved);
+    }
+}
+
+static stmt_ptr make_dot_stmt(const array_ptr & array, const dot_match & match)
+{
+    int last = (int) array->size.size() - 1;
+    int n = array->size[last];
+
+    // One instance per row, at the last element.
+
+    auto domain = array->domain;
+    domain.set_name(array->name + ".dot");
+    domain.add_constraint(domain.get_space().var(last) == n - 1);
+
+    auto stmt = make_shared<statement>(domain);
+    stmt->is_infinite = match.step->is_infinite;
+
+    {
+        int n_dim = array->domain.dimensions();
+        auto s = isl::space::from(stmt->domain.get_space(),
+                                  array->domain.get_space());
+        auto m = isl::multi_expression::zero(s, n_dim);
+        for (int d = 0; d < n_dim; ++d)
+            m.set(d, s.in(d));
+        stmt->write_relation = array_relation(array, m);
+    }
+
+    // The instance reads everything read by the original statements
+    // for the entire row.
+
+    unordered_map<array_relation*, array_relation*> moved;
+
+    for (auto & source : { match.init, match.step })
+    {
+        auto space = isl::space::from(source->domain.get_space(),
+                                      stmt->domain.get_space());
+        auto to_last = isl::basic_map::universe(space);
+        for (int d = 0; d < last; ++d)
+            to_last.add_constraint(space.out(d) == space.in(d));
+        to_last.add_constraint(space.out(last) == n - 1);
+
+        for (auto & rel : source->read_relations)
+        {
+            if (rel.array == array)
+                continue;
+
+            isl::map access = to_isl_map(source, rel);
+            access = isl_map_intersect_domain(access.copy(), source->domain.copy());
+            access = isl_map_apply_domain(access.copy(),
+                                          isl_map_from_basic_map(to_last.copy()));
+
+            stmt->read_relations.emplace_back(rel.array, access);
+            moved.emplace(&rel, &stmt->read_relations.back());
+        }
+    }
+
+    auto dot = make_shared<dot_product>();
+    dot->type = make_shared<functional::scalar_type>(array->type);
+    dot->init = match.init->expr;
+    dot->lhs = match.lhs;
+    dot->rhs = match.rhs;
+    dot->size = n;
+
+    update_relation_pointers(dot->init, moved);
+    update_relation_pointers(dot->lhs, moved);
+    update_relation_pointers(dot->rhs, moved);
+
+    stmt->expr = dot;
+
+    return stmt;
+}
+
+void map_kernels(model & m)
+{
+    if (verbose<kernel_mapping>::enabled())
+        cout << "### KERNEL MAPPING ###" << endl;
+
+    isl::printer printer(m.context);
+
+    for (auto & array : m.arrays)
+    {
+        dot_match match;
+        if (!match_dot_product(m, array, match))
+            continue;
+
+        auto stmt = make_dot_stmt(array, match);
+
+        auto & stmts = m.statements;
+        stmts.erase(std::remove_if(stmts.begin(), stmts.end(),
+                                   [&](const stmt_ptr & s)
+                    { return s == match.init || s == match.step; }),
+                    stmts.end());
+        stmts.push_back(stmt);
+
+        if (verbose<kernel_mapping>::enabled())
+        {
+            cout << "Dot product: " << array->name
+                 << " = " << match.lhs->array->name
+                 << " * " << match.rhs->array->name
+                 << " (" << array->size.back() << " elements)" << endl;
+            cout << "..Domain: ";
+            printer.print(stmt->domain);
+            cout << endl;
+            for (auto & rel : stmt->read_relations)
+            {
+                cout << "..Reads: ";
+                printer.print(rel.map);
+                cout << endl;
+            }
+        }
+    }
+}
+
+}
+}
@@ -0,0 +1,47 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef STREAM_LANG_POLYHEDRAL_KERNEL_MAPPING_INCLUDED
+#define STREAM_LANG_POLYHEDRAL_KERNEL_MAPPING_INCLUDED
+
+#include "../common/ph_model.hpp"
+
+namespace stream {
+namespace polyhedral {
+
+struct kernel_mapping;
+
+/*
+Finds arrays computed as a running sum of products along their
+last dimension, of which only the last element is ever read:
+
+  s[...,0] = init
+  s[...,i] = a[...] * b[...] + s[...,i-1]
+
+This covers dot products, and hence also matrix-vector and
+matrix-matrix products and FIR filters. The two statements are
+replaced by a single dot_product statement per row.
+*/
+void map_kernels(model &);
+
+}
+}
+
+#endif // STREAM_LANG_POLYHEDRAL_KERNEL_MAPPING_INCLUDED
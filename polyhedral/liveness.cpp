@@ -0,0 +1,253 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "liveness.hpp"
+#include "../utility/debug.hpp"
+
+#include <isl-cpp/printer.hpp>
+
+#include <iostream>
+#include <algorithm>
+#include <unordered_set>
+
+using namespace std;
+
+namespace stream {
+namespace polyhedral {
+
+namespace {
+
+// Recursive arrays need one round per step of the recursion.
+// After that, all their elements are assumed live.
+const int max_recursion_rounds = 16;
+
+class liveness_analysis
+{
+public:
+    liveness_analysis(model & m): m_model(m) {}
+
+    void process();
+
+private:
+    void order_arrays();
+    void order_arrays(array * a, unordered_set<array*> & visited);
+    void add_reads(const stmt_ptr & stmt, const isl::set & instances, bool self);
+    isl::set live_instances(const stmt_ptr & stmt, const isl::set & elements);
+    bool restrict(const stmt_ptr & stmt, const isl::set & instances);
+
+    model & m_model;
+    unordered_map<array*, vector<stmt_ptr>> m_writers;
+    unordered_map<array*, isl::set> m_live;
+    vector<array*> m_order;
+};
+
+void liveness_analysis::process()
+{
+    for (auto & stmt : m_model.statements)
+    {
+        if (stmt->write_relation.array)
+            m_writers[stmt->write_relation.array.get()].push_back(stmt);
+    }
+
+    for (auto & a : m_model.arrays)
+        m_live.emplace(a.get(), isl::set(a->domain.get_space()));
+
+    order_arrays();
+
+    // Statements which do not write arrays produce output.
+
+    for (auto & stmt : m_model.statements)
+    {
+        if (!stmt->write_relation.array)
+            add_reads(stmt, stmt->domain, false);
+    }
+
+    // Readers are complete before arrays they read.
+
+    unordered_map<statement*, isl::set> instances;
+
+    for (auto a : m_order)
+    {
+        auto & writers = m_writers[a];
+        auto & live = m_live.at(a);
+
+        int round = 0;
+        while(true)
+        {
+            auto previous = live;
+
+            for (auto & stmt : writers)
+                add_reads(stmt, live_instances(stmt, live), true);
+
+            if (live == previous)
+                break;
+
+            if (++round == max_recursion_rounds)
+            {
+                live = a->domain;
+                break;
+            }
+        }
+
+        for (auto & stmt : writers)
+        {
+            auto stmt_instances = live_instances(stmt, live);
+            add_reads(stmt, stmt_instances, false);
+            instances.emplace(stmt.get(), stmt_instances);
+        }
+    }
+
+    int removed_stmt_count = 0;
+    auto & stmts = m_model.statements;
+    stmts.erase(std::remove_if(stmts.begin(), stmts.end(),
+                               [&](const stmt_ptr & stmt)
+    {
+        auto it = instances.find(stmt.get());
+        if (it == instances.end())
+            return false;
+
+        bool removed = restrict(stmt, it->second);
+        if (removed)
+            ++removed_stmt_count;
+        return removed;
+    }), stmts.end());
+
+    auto & arrays = m_model.arrays;
+    arrays.erase(std::remove_if(arrays.begin(), arrays.end(),
+                                [&](const array_ptr & a)
+    {
+        bool dead = m_live.at(a.get()).is_empty();
+        if (dead && verbose<liveness>::enabled())
+            cout << "Removed dead array " << a->name << endl;
+        return dead;
+    }), arrays.end());
+
+    if (verbose<liveness>::enabled())
+        cout << "Removed " << removed_stmt_count << " dead statements." << endl;
+}
+
+void liveness_analysis::order_arrays()
+{
+    unordered_set<array*> visited;
+    for (auto & a : m_model.arrays)
+        order_arrays(a.get(), visited);
+
+    // Post-order lists arrays before their readers.
+    std::reverse(m_order.begin(), m_order.end());
+}
+
+void liveness_analysis::order_arrays(array * a, unordered_set<array*> & visited)
+{
+    if (!visited.insert(a).second)
+        return;
+
+    for (auto & stmt : m_writers[a])
+    {
+        for (auto & rel : stmt->read_relations)
+        {
+            if (rel.array.get() != a)
+                order_arrays(rel.array.get(), visited);
+        }
+    }
+
+    m_order.push_back(a);
+}
+
+void liveness_analysis::add_reads
+(const stmt_ptr & stmt, const isl::set & instances, bool self)
+{
+    auto written = stmt->write_relation.array.get();
+
+    for (auto & rel : stmt->read_relations)
+    {
+        if ((rel.array.get() == written) != self)
+            continue;
+
+        isl::map access = to_isl_map(stmt, rel);
+        isl::set elements = isl_set_apply(instances.copy(), access.copy());
+
+        auto & live = m_live.at(rel.array.get());
+        live = live | (elements & rel.array->domain);
+        live.coalesce();
+    }
+}
+
+isl::set liveness_analysis::live_instances
+(const stmt_ptr & stmt, const isl::set & elements)
+{
+    isl::map write = to_isl_map(stmt, stmt->write_relation);
+    isl::set result = isl_set_apply(elements.copy(), isl_map_reverse(write.copy()));
+    result = result & stmt->domain;
+
+    if (stmt->is_infinite && !result.is_empty())
+    {
+        // Extend to all times.
+        auto space = isl::space::from(stmt->domain.get_space(),
+                                      stmt->domain.get_space());
+        auto all_times = isl::basic_map::universe(space);
+        for (int d = 1; d < stmt->domain.dimensions(); ++d)
+            all_times.add_constraint(space.out(d) == space.in(d));
+
+        result = isl_set_apply(result.copy(), isl_map_from_basic_map(all_times.copy()));
+        result = result & stmt->domain;
+    }
+
+    result.coalesce();
+
+    return result;
+}
+
+bool liveness_analysis::restrict(const stmt_ptr & stmt, const isl::set & instances)
+{
+    if (instances.is_empty())
+    {
+        if (verbose<liveness>::enabled())
+            cout << "Removed dead statement " << stmt->name << endl;
+        return true;
+    }
+
+    if (instances == stmt->domain)
+        return false;
+
+    stmt->domain = instances;
+
+    if (verbose<liveness>::enabled())
+    {
+        cout << "Restricted domain of statement " << stmt->name << ":" << endl;
+        isl::printer printer(m_model.context);
+        printer.print(stmt->domain); cout << endl;
+    }
+
+    return false;
+}
+
+}
+
+void eliminate_dead_elements(model & m)
+{
+    if (verbose<liveness>::enabled())
+        cout << "### LIVENESS ###" << endl;
+
+    liveness_analysis analysis(m);
+    analysis.process();
+}
+
+}
+}
@@ -0,0 +1,46 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef STREAM_LANG_POLYHEDRAL_LIVENESS_INCLUDED
+#define STREAM_LANG_POLYHEDRAL_LIVENESS_INCLUDED
+
+#include "../common/ph_model.hpp"
+
+namespace stream {
+namespace polyhedral {
+
+struct liveness;
+
+/*
+Restricts statement domains to instances which compute array
+elements that are eventually read by the output, following read
+relations backwards from the output statement.
+Statements and arrays which are never needed are removed.
+
+Unbounded statements are only restricted in dimensions other than
+the first (time), and the same restriction applies at all times,
+so that streaming is not affected.
+*/
+void eliminate_dead_elements(model &);
+
+}
+}
+
+#endif // STREAM_LANG_POLYHEDRAL_LIVENESS_INCLUDED
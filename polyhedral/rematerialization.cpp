@@ -0,0 +1,420 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "rematerialization.hpp"
+#include "../utility/debug.hpp"
+
+#include <iostream>
+#include <algorithm>
+#include <complex>
+
+using namespace std;
+
+namespace stream {
+namespace polyhedral {
+
+using functional::expr_ptr;
+using functional::primitive;
+
+namespace {
+
+// Arrays which cost more operations per element are kept.
+const int max_recompute_cost = 8;
+
+int element_size(primitive_type t)
+{
+    switch(t)
+    {
+    case primitive_type::boolean:
+        return sizeof(bool);
+    case primitive_type::integer:
+        return sizeof(int);
+    case primitive_type::real32:
+        return sizeof(float);
+    case primitive_type::real64:
+        return sizeof(double);
+    case primitive_type::complex32:
+        return sizeof(complex<float>);
+    case primitive_type::complex64:
+        return sizeof(complex<double>);
+    default:
+        return 0;
+    }
+}
+
+int buffer_memory(const array_ptr & a)
+{
+    if (a->buffer_size.empty())
+        return 0;
+    int size = element_size(a->type);
+    for (auto s : a->buffer_size)
+        size *= s;
+    return size;
+}
+
+// Operation count of an expression which only consists of
+// primitive operations, constants, iterators and array reads.
+// Returns -1 for any other expression.
+int recompute_cost(const expr_ptr & expr, const array_ptr & written)
+{
+    if (auto op = dynamic_cast<primitive*>(expr.get()))
+    {
+        int cost = 1;
+        switch(op->kind)
+        {
+        case primitive_op::negate:
+        case primitive_op::add:
+        case primitive_op::subtract:
+        case primitive_op::multiply:
+        case primitive_op::min:
+        case primitive_op::max:
+        case primitive_op::abs:
+        case primitive_op::floor:
+        case primitive_op::ceil:
+        case primitive_op::real:
+        case primitive_op::imag:
+        case primitive_op::to_real32:
+        case primitive_op::to_real64:
+        case primitive_op::to_complex32:
+        case primitive_op::to_complex64:
+        case primitive_op::compare_eq:
+        case primitive_op::compare_neq:
+        case primitive_op::compare_l:
+        case primitive_op::compare_g:
+        case primitive_op::compare_leq:
+        case primitive_op::compare_geq:
+        case primitive_op::logic_and:
+        case primitive_op::logic_or:
+        case primitive_op::conditional:
+            break;
+        case primitive_op::divide:
+        case primitive_op::divide_integer:
+        case primitive_op::modulo:
+        case primitive_op::sqrt:
+            cost = 4;
+            break;
+        default:
+            return -1;
+        }
+
+        for (auto & operand : op->operands)
+        {
+            int c = recompute_cost(operand, written);
+            if (c < 0)
+                return -1;
+            cost += c;
+        }
+
+        return cost;
+    }
+    else if (auto read = dynamic_cast<array_read*>(expr.get()))
+    {
+        if (read->array == written || !read->relation)
+            return -1;
+
+        int cost = 1;
+        for (auto & index : read->indexes)
+        {
+            int c = recompute_cost(index, written);
+            if (c < 0)
+                return -1;
+            cost += c;
+        }
+        return cost;
+    }
+    else if (dynamic_cast<iterator_read*>(expr.get()) ||
+             dynamic_cast<functional::int_const*>(expr.get()) ||
+             dynamic_cast<functional::real_const*>(expr.get()) ||
+             dynamic_cast<functional::bool_const*>(expr.get()) ||
+             dynamic_cast<functional::complex_const*>(expr.get()))
+    {
+        return 0;
+    }
+
+    return -1;
+}
+
+struct candidate
+{
+    array_ptr array;
+    stmt_ptr source;
+    int memory = 0;
+    int cost = 0;
+    int reads = 0;
+};
+
+class rematerializer
+{
+public:
+    rematerializer(model & m): m_model(m) {}
+
+    bool find_candidate(candidate & best);
+    void apply(const candidate &);
+
+private:
+    // Replaces reads of the candidate array in 'expr', if 'apply' is set.
+    // Otherwise only counts them.
+    expr_ptr process(const expr_ptr & expr, int & count);
+
+    expr_ptr recompute(const shared_ptr<array_read> & read);
+    expr_ptr substitute(const expr_ptr & expr, const shared_ptr<array_read> & read);
+
+    model & m_model;
+    const candidate * m_candidate = nullptr;
+    stmt_ptr m_reader;
+    bool m_apply = false;
+};
+
+bool rematerializer::find_candidate(candidate & best)
+{
+    bool found = false;
+
+    for (auto & a : m_model.arrays)
+    {
+        if (!a->is_infinite)
+            continue;
+
+        candidate c;
+        c.array = a;
+        c.memory = buffer_memory(a);
+        if (c.memory == 0)
+            continue;
+
+        bool ok = true;
+        int relation_count = 0;
+
+        for (auto & stmt : m_model.statements)
+        {
+            if (stmt->write_relation.array == a)
+            {
+                if (c.source)
+                    ok = false;
+                c.source = stmt;
+            }
+
+            int stmt_relation_count = 0;
+            for (auto & rel : stmt->read_relations)
+            {
+                if (rel.array == a)
+                    ++stmt_relation_count;
+            }
+
+            // The output is kept.
+            if (stmt_relation_count && !stmt->write_relation.array)
+                ok = false;
+
+            relation_count += stmt_relation_count;
+        }
+
+        if (!ok || !c.source || !c.source->is_infinite)
+            continue;
+
+        c.cost = recompute_cost(c.source->expr, a);
+        if (c.cost < 0 || c.cost > max_recompute_cost)
+            continue;
+
+        // All reads must be replaceable expressions,
+        // not e.g. operands of dot products or transforms.
+        m_candidate = &c;
+        m_apply = false;
+        for (auto & stmt : m_model.statements)
+        {
+            m_reader = stmt;
+            process(stmt->expr, c.reads);
+        }
+        m_candidate = nullptr;
+
+        if (c.reads == 0 || c.reads != relation_count)
+            continue;
+
+        // Memory saved per operation added.
+        auto score = [](const candidate & c)
+        { return double(c.memory) / (c.cost * c.reads + 1); };
+
+        if (!found || score(c) > score(best))
+        {
+            best = c;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+void rematerializer::apply(const candidate & c)
+{
+    m_candidate = &c;
+    m_apply = true;
+
+    for (auto & stmt : m_model.statements)
+    {
+        if (stmt == c.source)
+            continue;
+
+        m_reader = stmt;
+        int count = 0;
+        stmt->expr = process(stmt->expr, count);
+
+        if (!count)
+            continue;
+
+        auto & rels = stmt->read_relations;
+        for (auto it = rels.begin(); it != rels.end(); )
+        {
+            if (it->array == c.array)
+                it = rels.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    m_candidate = nullptr;
+
+    auto & stmts = m_model.statements;
+    stmts.erase(std::remove(stmts.begin(), stmts.end(), c.source), stmts.end());
+
+    auto & arrays = m_model.arrays;
+    arrays.erase(std::remove(arrays.begin(), arrays.end(), c.array), arrays.end());
+}
+
+expr_ptr rematerializer::process(const expr_ptr & expr, int & count)
+{
+    if (auto read = dynamic_pointer_cast<array_read>(expr))
+    {
+        if (read->array != m_candidate->array)
+            return expr;
+        ++count;
+        if (m_apply)
+            return recompute(read);
+    }
+    else if (auto op = dynamic_pointer_cast<primitive>(expr))
+    {
+        for (auto & operand : op->operands)
+            operand = process(operand, count);
+    }
+    else if (auto call = dynamic_pointer_cast<external_call>(expr))
+    {
+        for (auto & arg : call->args)
+            arg = process(arg, count);
+    }
+    else if (auto dot = dynamic_pointer_cast<dot_product>(expr))
+    {
+        dot->init = process(dot->init, count);
+    }
+
+    return expr;
+}
+
+expr_ptr rematerializer::recompute(const shared_ptr<array_read> & read)
+{
+    return substitute(m_candidate->source->expr, read);
+}
+
+// Copy of an expression of the source statement, evaluated
+// at the source instance which computes the element read by 'read'.
+expr_ptr rematerializer::substitute
+(const expr_ptr & expr, const shared_ptr<array_read> & read)
+{
+    if (auto it = dynamic_cast<iterator_read*>(expr.get()))
+    {
+        // Statement instances map to array elements by identity.
+        return read->indexes[it->index];
+    }
+    else if (auto op = dynamic_cast<primitive*>(expr.get()))
+    {
+        auto copy = make_shared<primitive>();
+        copy->kind = op->kind;
+        copy->location = op->location;
+        copy->type = op->type;
+        for (auto & operand : op->operands)
+            copy->operands.emplace_back(substitute(operand, read));
+        return copy;
+    }
+    else if (auto inner = dynamic_cast<array_read*>(expr.get()))
+    {
+        auto copy = make_shared<array_read>();
+        copy->array = inner->array;
+        copy->location = inner->location;
+        copy->type = inner->type;
+        for (auto & index : inner->indexes)
+            copy->indexes.push_back(substitute(index, read));
+
+        // reader -> element of candidate -> source instance -> inner element
+        auto source = m_candidate->source;
+        isl::map access = to_isl_map(m_reader, *read->relation);
+        isl::map write = to_isl_map(source, source->write_relation);
+        isl::map inner_access = to_isl_map(source, *inner->relation);
+        access = isl_map_apply_range(access.copy(), isl_map_reverse(write.copy()));
+        access = isl_map_apply_range(access.copy(), inner_access.copy());
+
+        m_reader->read_relations.emplace_back(inner->array, access);
+        copy->relation = &m_reader->read_relations.back();
+
+        return copy;
+    }
+
+    // Constants
+    return expr;
+}
+
+}
+
+int buffer_memory(const model & m)
+{
+    int total = 0;
+    for (auto & a : m.arrays)
+        total += buffer_memory(a);
+    return total;
+}
+
+bool rematerialize_array(model & m, int memory_budget)
+{
+    int memory = buffer_memory(m);
+
+    if (verbose<rematerialization>::enabled())
+    {
+        cout << "Buffer memory: " << memory << " bytes"
+             << " (budget: " << memory_budget << " bytes)" << endl;
+    }
+
+    if (memory <= memory_budget)
+        return false;
+
+    rematerializer r(m);
+
+    candidate c;
+    if (!r.find_candidate(c))
+        return false;
+
+    if (verbose<rematerialization>::enabled())
+    {
+        cout << "Recomputing array " << c.array->name
+             << " at " << c.reads << " reads"
+             << " (" << c.cost << " operations each)"
+             << " instead of storing " << c.memory << " bytes." << endl;
+    }
+
+    r.apply(c);
+
+    return true;
+}
+
+}
+}
@@ -0,0 +1,51 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef STREAM_LANG_POLYHEDRAL_REMATERIALIZATION_INCLUDED
+#define STREAM_LANG_POLYHEDRAL_REMATERIALIZATION_INCLUDED
+
+#include "../common/ph_model.hpp"
+
+namespace stream {
+namespace polyhedral {
+
+struct rematerialization;
+
+// Total size of allocated buffers in bytes.
+int buffer_memory(const model &);
+
+/*
+If the buffers allocated for the model exceed memory_budget bytes,
+removes one cheaply computed streaming array and recomputes its
+elements in each statement which reads them instead.
+The array is chosen by the amount of memory saved per operation
+spent on recomputation.
+
+Returns whether the model was changed. If so, the model must
+be scheduled and its storage allocated again. Recomputed elements
+are read at new positions of other arrays, whose buffers may grow,
+so memory use should be checked again after allocation.
+*/
+bool rematerialize_array(model &, int memory_budget);
+
+}
+}
+
+#endif // STREAM_LANG_POLYHEDRAL_REMATERIALIZATION_INCLUDED
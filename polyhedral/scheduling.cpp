@@ -115,6 +115,9 @@ scheduler::schedule(bool optimize, const vector<reversal> & reversals)
                                    m_model_summary.dependencies,
                                    optimize);
 
+    if (m_tile)
+        tile_finite_bands(schedule.tree);
+
     schedule.full = schedule.tree.map().in_domain(m_model_summary.domains);
 
     if (verbose<scheduler>::enabled())
@@ -347,7 +350,11 @@ isl::schedule scheduler::make_schedule
     // FIXME: statements with no dependencies
     // seem to always end up with an empty schedule.
 
-    isl_options_set_schedule_whole_component(domains.ctx().get(), m_schedule_whole);
+    bool whole_component = m_schedule_whole || m_fusion == max_fusion;
+    bool serialize_sccs = m_fusion == min_fusion;
+
+    isl_options_set_schedule_whole_component(domains.ctx().get(), whole_component);
+    isl_options_set_schedule_serialize_sccs(domains.ctx().get(), serialize_sccs);
 
     isl_schedule_constraints *constr =
             isl_schedule_constraints_on_domain(domains.copy());
@@ -362,6 +369,11 @@ isl::schedule scheduler::make_schedule
         auto proximity_deps = make_proximity_dependencies(dependencies);
         constr = isl_schedule_constraints_set_proximity(constr, proximity_deps.copy());
         //constr = isl_schedule_constraints_set_coincidence(constr, proximity_deps.copy());
+
+        // Prefer outer schedule dimensions along which fused producers
+        // and consumers are independent, rather than diagonal ones.
+        if (m_fusion == group_fusion)
+            constr = isl_schedule_constraints_set_coincidence(constr, proximity_deps.copy());
     }
 
     isl_schedule * sched =
@@ -371,6 +383,138 @@ isl::schedule scheduler::make_schedule
     return sched;
 }
 
+void scheduler::tile_finite_bands(isl::schedule & sched)
+{
+    // Tiling is applied to the entire schedule tree,
+    // before it is split into prelude and period,
+    // so that all schedules derived from it agree,
+    // including the tiled schedule used for storage allocation.
+
+    auto root = isl_schedule_get_root(sched.get());
+    root = tile_finite_bands(root);
+    sched = isl_schedule_node_get_schedule(root);
+    isl_schedule_node_free(root);
+
+    if (verbose<scheduler>::enabled())
+    {
+        cout << endl << "Tiled schedule tree:" << endl;
+        isl_printer_print_schedule(m_printer.get(), sched.get());
+        cout << endl;
+    }
+}
+
+isl_schedule_node * scheduler::tile_finite_bands(isl_schedule_node * node)
+{
+    int added_levels = 0;
+
+    if (isl_schedule_node_get_type(node) == isl_schedule_node_band)
+        node = tile_band(node, added_levels);
+
+    int n_children = isl_schedule_node_n_children(node);
+    for (int c = 0; c < n_children; ++c)
+    {
+        node = isl_schedule_node_child(node, c);
+        node = tile_finite_bands(node);
+        node = isl_schedule_node_parent(node);
+    }
+
+    for (int i = 0; i < added_levels; ++i)
+        node = isl_schedule_node_parent(node);
+
+    return node;
+}
+
+isl_schedule_node * scheduler::tile_band(isl_schedule_node * node, int & added_levels)
+{
+    if (isl_schedule_node_band_get_permutable(node) != isl_bool_true)
+        return node;
+
+    int n_members = isl_schedule_node_band_n_member(node);
+
+    isl::union_set domain = isl_schedule_node_get_domain(node);
+    isl::union_map partial =
+            isl_schedule_node_band_get_partial_schedule_union_map(node);
+    partial = partial.in_domain(domain);
+
+    int stmt_count = 0;
+    partial.for_each([&](const isl::map &){
+        ++stmt_count;
+        return true;
+    });
+
+    // Extent of each member, and the first of the trailing finite members.
+
+    vector<int> extent(n_members, 1);
+    int first_finite = 0;
+
+    partial.range().for_each([&](const isl::set & range)
+    {
+        if (range.is_empty())
+            return true;
+        for (int i = 0; i < n_members; ++i)
+        {
+            auto v = range.get_space().var(i);
+            auto max = range.maximum(v);
+            if (max.is_infinity())
+            {
+                first_finite = std::max(first_finite, i + 1);
+                continue;
+            }
+            auto min = range.minimum(v);
+            extent[i] = std::max(extent[i], int(max.integer() - min.integer() + 1));
+        }
+        return true;
+    });
+
+    int tiled_count = n_members - first_finite;
+    if (tiled_count < 2)
+        return node;
+
+    int size = m_tile_size;
+    if (size <= 0)
+    {
+        // A tile of each statement should fit into the L1 cache.
+        const double cache_elements = 32 * 1024 / sizeof(double);
+        int max_size = (int) std::pow(cache_elements / stmt_count, 1.0 / tiled_count);
+        size = 4;
+        while (size * 2 <= max_size)
+            size *= 2;
+    }
+
+    bool is_tiled = false;
+    for (int i = first_finite; i < n_members; ++i)
+        is_tiled |= extent[i] > size;
+    if (!is_tiled)
+        return node;
+
+    if (first_finite > 0)
+    {
+        node = isl_schedule_node_band_split(node, first_finite);
+        node = isl_schedule_node_child(node, 0);
+        ++added_levels;
+    }
+
+    auto ctx = isl_schedule_node_get_ctx(node);
+    auto sizes = isl_multi_val_zero(isl_schedule_node_band_get_space(node));
+    for (int i = 0; i < tiled_count; ++i)
+    {
+        int member_size = std::min(size, extent[first_finite + i]);
+        sizes = isl_multi_val_set_val(sizes, i, isl_val_int_from_si(ctx, member_size));
+    }
+
+    if (verbose<scheduler>::enabled())
+    {
+        cout << "Tiling band members " << first_finite << " to " << n_members - 1
+             << " with size " << size << "." << endl;
+    }
+
+    node = isl_schedule_node_band_tile(node, sizes);
+    node = isl_schedule_node_child(node, 0);
+    ++added_levels;
+
+    return node;
+}
+
 isl::union_map
 scheduler::make_proximity_dependencies(const isl::union_map & dependencies)
 {
@@ -380,8 +524,40 @@ scheduler::make_proximity_dependencies(const isl::union_map & dependencies)
 
     isl::union_map proximity_deps(dependencies.ctx());
 
+    // Arrays written by statements reading each array.
+    // A null array stands for the output.
+    unordered_map<array*, unordered_set<array*>> consumers;
+    if (m_fusion == group_fusion)
+    {
+        for (auto & stmt : m_model.statements)
+        {
+            auto written = stmt->write_relation.array.get();
+            for (auto & rel : stmt->read_relations)
+            {
+                if (rel.array.get() != written)
+                    consumers[rel.array.get()].insert(written);
+            }
+        }
+    }
+
     dependencies.for_each([&](const isl::map & m)
     {
+        if (m_fusion == group_fusion)
+        {
+            auto source = statement_for(m.id(isl::space::input));
+            auto sink = statement_for(m.id(isl::space::output));
+            auto produced = source->write_relation.array.get();
+            if (sink->write_relation.array.get() != produced &&
+                    consumers[produced].size() > 1)
+            {
+                if (verbose<scheduler>::enabled()) {
+                    cout << "Not fusing producer with one of multiple consumers:";
+                    m_printer.print(m); cout << endl;
+                }
+                return true;
+            }
+        }
+
         m.for_each([&](const isl::basic_map & dep)
         {
             int source_dim = m.get_space().dimension(isl::space::input);
@@ -85,6 +85,21 @@ public:
         int dim;
     };
 
+    // Which statements isl is asked to fuse into common loops.
+    enum fusion_strategy
+    {
+        // isl decides, merging clusters of statements
+        // when this does not lose parallelism.
+        default_fusion,
+        // Schedule each connected component as a whole.
+        max_fusion,
+        // Each strongly connected component in its own loops.
+        min_fusion,
+        // Fuse producers with their only consumer, such as
+        // the map and reduction steps of a sum of products.
+        group_fusion
+    };
+
     scheduler( model & m );
 
     void set_schedule_whole_program(bool flag)
@@ -92,6 +107,19 @@ public:
         m_schedule_whole = flag;
     }
 
+    void set_fusion_strategy(fusion_strategy strategy)
+    {
+        m_fusion = strategy;
+    }
+
+    // Tile permutable bands of finite schedule dimensions.
+    // A size of 0 derives tile sizes from the cache size.
+    void set_tiling(bool enabled, int size = 0)
+    {
+        m_tile = enabled;
+        m_tile_size = size;
+    }
+
     polyhedral::schedule schedule
     (bool optimize, const vector<reversal> & reversals);
 
@@ -139,6 +167,10 @@ private:
 
     isl::union_map make_proximity_dependencies(const isl::union_map & dependencies);
 
+    void tile_finite_bands(isl::schedule &);
+    isl_schedule_node * tile_finite_bands(isl_schedule_node *);
+    isl_schedule_node * tile_band(isl_schedule_node *, int & added_levels);
+
     void make_periodic_schedule(polyhedral::schedule &);
 
     void find_stream_dim_and_period(const isl::union_map & schedule,
@@ -166,6 +198,9 @@ private:
     model_summary m_model_summary;
 
     bool m_schedule_whole = false;
+    fusion_strategy m_fusion = default_fusion;
+    bool m_tile = false;
+    int m_tile_size = 0;
 };
 
 }
@@ -57,6 +57,27 @@ void storage_allocator::allocate(const polyhedral::schedule & schedule)
 
         find_inter_period_dependency(schedule, array);
     }
+
+    // Array transforms access entire rows at once,
+    // so the transformed dimension must be fully stored.
+
+    for (auto & stmt : m_model.statements)
+    {
+        auto transform = dynamic_pointer_cast<transform_call>(stmt->expr);
+        if (!transform)
+            continue;
+
+        for (auto & array : { transform->input, stmt->write_relation.array })
+        {
+            array->buffer_size.back() = array->size.back();
+
+            if (verbose<storage_allocator>::enabled())
+            {
+                cout << "Keeping entire rows of array " << array->name
+                     << " for transform " << stmt->name << endl;
+            }
+        }
+    }
 }
 
 void storage_allocator::compute_buffer_size
@@ -0,0 +1,466 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#include "tabulation.hpp"
+#include "../common/func_model_printer.hpp"
+#include "../utility/debug.hpp"
+
+#include <isl-cpp/printer.hpp>
+
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+namespace stream {
+namespace polyhedral {
+
+using functional::expr_ptr;
+using functional::primitive;
+
+namespace {
+
+// A table index: either a bounded statement iterator,
+// or "e % P" where e is a non-negative integer expression.
+struct table_key
+{
+    expr_ptr expr;
+    int iterator = -1;
+    int extent = 0;
+};
+
+bool is_transcendental(primitive_op op)
+{
+    switch(op)
+    {
+    case primitive_op::log:
+    case primitive_op::log2:
+    case primitive_op::log10:
+    case primitive_op::exp:
+    case primitive_op::exp2:
+    case primitive_op::raise:
+    case primitive_op::sin:
+    case primitive_op::cos:
+    case primitive_op::tan:
+    case primitive_op::asin:
+    case primitive_op::acos:
+    case primitive_op::atan:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool is_expensive(const expr_ptr & expr)
+{
+    auto op = dynamic_cast<primitive*>(expr.get());
+    if (!op)
+        return false;
+    if (is_transcendental(op->kind))
+        return true;
+    for (auto & operand : op->operands)
+    {
+        if (is_expensive(operand))
+            return true;
+    }
+    return false;
+}
+
+bool is_same(const expr_ptr & a, const expr_ptr & b)
+{
+    if (auto ia = dynamic_cast<iterator_read*>(a.get()))
+    {
+        auto ib = dynamic_cast<iterator_read*>(b.get());
+        return ib && ib->index == ia->index;
+    }
+    if (auto ca = dynamic_cast<functional::int_const*>(a.get()))
+    {
+        auto cb = dynamic_cast<functional::int_const*>(b.get());
+        return cb && cb->value == ca->value;
+    }
+    if (auto pa = dynamic_cast<primitive*>(a.get()))
+    {
+        auto pb = dynamic_cast<primitive*>(b.get());
+        if (!pb || pb->kind != pa->kind || pb->operands.size() != pa->operands.size())
+            return false;
+        for (int i = 0; i < (int) pa->operands.size(); ++i)
+        {
+            if (!is_same(pa->operands[i], pb->operands[i]))
+                return false;
+        }
+        return true;
+    }
+    return false;
+}
+
+// Sum of iterators with non-negative constant factors
+// and non-negative constants.
+bool is_non_negative_index(const expr_ptr & expr)
+{
+    if (dynamic_cast<iterator_read*>(expr.get()))
+        return true;
+    if (auto c = dynamic_cast<functional::int_const*>(expr.get()))
+        return c->value >= 0;
+    if (auto op = dynamic_cast<primitive*>(expr.get()))
+    {
+        if (op->kind == primitive_op::add)
+        {
+            return is_non_negative_index(op->operands[0]) &&
+                    is_non_negative_index(op->operands[1]);
+        }
+        if (op->kind == primitive_op::multiply)
+        {
+            for (int k = 0; k < 2; ++k)
+            {
+                auto c = dynamic_cast<functional::int_const*>(op->operands[k].expr.get());
+                if (c && c->value >= 0)
+                    return is_non_negative_index(op->operands[1-k]);
+            }
+        }
+    }
+    return false;
+}
+
+// Does the expression involve more than conversions?
+bool has_computation(const expr_ptr & expr)
+{
+    auto op = dynamic_cast<primitive*>(expr.get());
+    if (!op)
+        return false;
+
+    switch(op->kind)
+    {
+    case primitive_op::to_real32:
+    case primitive_op::to_real64:
+    case primitive_op::to_complex32:
+    case primitive_op::to_complex64:
+    case primitive_op::negate:
+        break;
+    default:
+        return true;
+    }
+
+    for (auto & operand : op->operands)
+    {
+        if (has_computation(operand))
+            return true;
+    }
+    return false;
+}
+
+class tabulator
+{
+public:
+    enum mode
+    {
+        // Expressions of bounded or periodic indexes into tables
+        tabulate,
+        // Constant expressions into scalars
+        hoist
+    };
+
+    tabulator(model & m, mode md, int max_size):
+        m_model(m), m_mode(md), m_max_size(max_size) {}
+
+    void process(const stmt_ptr & stmt)
+    {
+        m_stmt = stmt;
+        m_stmt->expr = visit(m_stmt->expr);
+    }
+
+private:
+    expr_ptr visit(const expr_ptr & expr)
+    {
+        if (expr->type && expr->type->is_scalar())
+        {
+            vector<table_key> keys;
+            if (m_mode == tabulate && is_expensive(expr) &&
+                    collect_keys(expr, keys) &&
+                    !keys.empty() && size_of(keys) <= m_max_size)
+            {
+                auto name = m_stmt->name + ".tab" + to_string(m_count++);
+                if (verbose<tabulation>::enabled())
+                {
+                    cout << "Tabulated expression in " << m_stmt->name
+                         << " as " << name << " [ ";
+                    for (auto & key : keys)
+                        cout << key.extent << " ";
+                    cout << "]" << endl;
+                }
+                return make_table(expr, keys, name);
+            }
+            if (m_mode == hoist && has_computation(expr) &&
+                    collect_keys(expr, keys) && keys.empty())
+            {
+                auto name = m_stmt->name + ".inv" + to_string(m_count++);
+                if (verbose<invariant_hoisting>::enabled())
+                {
+                    functional::printer printer;
+                    cout << "Hoisted from " << m_stmt->name
+                         << " as " << name << ": ";
+                    printer.print(expr, cout);
+                    cout << endl;
+                }
+                return make_table(expr, keys, name);
+            }
+        }
+
+        if (auto op = dynamic_cast<primitive*>(expr.get()))
+        {
+            for (auto & operand : op->operands)
+                operand = visit(operand);
+        }
+
+        return expr;
+    }
+
+    bool collect_keys(const expr_ptr & expr, vector<table_key> & keys)
+    {
+        if (auto it = dynamic_cast<iterator_read*>(expr.get()))
+        {
+            auto & array = m_stmt->write_relation.array;
+            if (!array || it->index >= (int) array->size.size())
+                return false;
+            int extent = array->size[it->index];
+            if (extent < 0)
+                return false;
+            add_key(keys, expr, it->index, extent);
+            return true;
+        }
+        else if (auto op = dynamic_cast<primitive*>(expr.get()))
+        {
+            if (op->kind == primitive_op::modulo)
+            {
+                auto p = dynamic_cast<functional::int_const*>(op->operands[1].expr.get());
+                if (p && p->value > 0 && is_non_negative_index(op->operands[0]))
+                {
+                    add_key(keys, expr, -1, p->value);
+                    return true;
+                }
+            }
+
+            for (auto & operand : op->operands)
+            {
+                if (!collect_keys(operand, keys))
+                    return false;
+            }
+            return true;
+        }
+        else if (dynamic_cast<functional::int_const*>(expr.get()) ||
+                 dynamic_cast<functional::real_const*>(expr.get()) ||
+                 dynamic_cast<functional::bool_const*>(expr.get()) ||
+                 dynamic_cast<functional::complex_const*>(expr.get()))
+        {
+            return true;
+        }
+
+        // Array reads, external calls, etc.
+        return false;
+    }
+
+    void add_key(vector<table_key> & keys, const expr_ptr & expr, int iterator, int extent)
+    {
+        for (auto & key : keys)
+        {
+            if (is_same(key.expr, expr))
+                return;
+        }
+
+        table_key key;
+        key.expr = expr;
+        key.iterator = iterator;
+        key.extent = extent;
+
+        // Iterator keys come first, so the read relation
+        // can be expressed exactly on the leading dimensions.
+        if (iterator >= 0)
+        {
+            auto pos = keys.begin();
+            while (pos != keys.end() && pos->iterator >= 0)
+                ++pos;
+            keys.insert(pos, key);
+        }
+        else
+        {
+            keys.push_back(key);
+        }
+    }
+
+    int size_of(const vector<table_key> & keys)
+    {
+        long size = 1;
+        for (auto & key : keys)
+        {
+            size *= key.extent;
+            if (size > m_max_size)
+                break;
+        }
+        return (int) std::min(size, (long) m_max_size + 1);
+    }
+
+    // Rewrite expression in terms of table iterators.
+    expr_ptr table_expr(const expr_ptr & expr, const vector<table_key> & keys)
+    {
+        for (int k = 0; k < (int) keys.size(); ++k)
+        {
+            if (is_same(keys[k].expr, expr))
+                return make_shared<iterator_read>(k, expr->location);
+        }
+
+        if (auto op = dynamic_cast<primitive*>(expr.get()))
+        {
+            auto copy = make_shared<primitive>();
+            copy->kind = op->kind;
+            copy->location = op->location;
+            copy->type = op->type;
+            for (auto & operand : op->operands)
+                copy->operands.emplace_back(table_expr(operand, keys));
+            return copy;
+        }
+
+        return expr;
+    }
+
+    // Without keys, the table is a scalar.
+    expr_ptr make_table(const expr_ptr & expr, const vector<table_key> & keys,
+                        const string & name)
+    {
+        auto table = make_shared<array>();
+
+        auto tuple = isl::set_tuple( isl::identifier(name, table.get()),
+                                     std::max((int) keys.size(), 1) );
+        auto space = isl::space( m_model.context, tuple );
+        auto domain = isl::set::universe(space);
+        for (int d = 0; d < (int) keys.size(); ++d)
+        {
+            auto index = space.var(d);
+            domain.add_constraint(index >= 0);
+            domain.add_constraint(index < keys[d].extent);
+            table->size.push_back(keys[d].extent);
+        }
+        if (keys.empty())
+        {
+            domain.add_constraint(space.var(0) == 0);
+        }
+
+        table->name = name;
+        table->domain = domain;
+        table->type = expr->type->scalar()->primitive;
+        table->is_infinite = false;
+
+        m_model.arrays.push_back(table);
+
+        // Statement computing the table
+
+        {
+            auto stmt_domain = domain;
+            stmt_domain.set_name(name + ".s");
+            auto stmt = make_shared<statement>(stmt_domain);
+
+            int n_dim = domain.dimensions();
+            auto s = isl::space::from(stmt->domain.get_space(), domain.get_space());
+            auto m = isl::multi_expression::zero(s, n_dim);
+            for (int d = 0; d < n_dim; ++d)
+                m.set(d, s.in(d));
+            stmt->write_relation = array_relation(table, m);
+
+            stmt->expr = table_expr(expr, keys);
+
+            m_model.statements.push_back(stmt);
+        }
+
+        // Replace the expression with a table read
+
+        vector<expr_ptr> index;
+        for (auto & key : keys)
+            index.push_back(key.expr);
+        if (keys.empty())
+            index.push_back(make_shared<functional::int_const>(0));
+
+        auto read = make_shared<array_read>(table, index, expr->location);
+
+        {
+            int n_exact = 0;
+            while (n_exact < (int) keys.size() && keys[n_exact].iterator >= 0)
+                ++n_exact;
+
+            // Modulo indexes are not affine, so the relation
+            // spans the entire range of those dimensions.
+            auto s = isl::space::from(m_stmt->domain.get_space(), domain.get_space());
+            auto m = isl::multi_expression::zero(s, n_exact);
+            for (int d = 0; d < n_exact; ++d)
+                m.set(d, s.in(keys[d].iterator));
+
+            m_stmt->read_relations.emplace_back(table, m);
+            read->relation = &m_stmt->read_relations.back();
+        }
+
+        return read;
+    }
+
+    model & m_model;
+    mode m_mode;
+    int m_max_size;
+    stmt_ptr m_stmt;
+    int m_count = 0;
+};
+
+}
+
+void tabulate_periodic_expressions(model & m, int max_size)
+{
+    if (verbose<tabulation>::enabled())
+        cout << "### TABULATION ###" << endl;
+
+    if (max_size < 1)
+        return;
+
+    // Tables are appended to the model while iterating.
+    auto statements = m.statements;
+
+    tabulator t(m, tabulator::tabulate, max_size);
+
+    for (auto & stmt : statements)
+    {
+        if (!stmt->is_infinite)
+            continue;
+        t.process(stmt);
+    }
+}
+
+void hoist_invariant_expressions(model & m)
+{
+    if (verbose<invariant_hoisting>::enabled())
+        cout << "### INVARIANT HOISTING ###" << endl;
+
+    auto statements = m.statements;
+
+    tabulator t(m, tabulator::hoist, 1);
+
+    for (auto & stmt : statements)
+    {
+        if (!stmt->is_infinite)
+            continue;
+        t.process(stmt);
+    }
+}
+
+}
+}
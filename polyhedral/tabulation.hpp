@@ -0,0 +1,56 @@
+/*
+Compiler for language for stream processing
+
+Copyright (C) 2016  Jakob Leben <jakob.leben@gmail.com>
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+*/
+
+#ifndef STREAM_LANG_POLYHEDRAL_TABULATION_INCLUDED
+#define STREAM_LANG_POLYHEDRAL_TABULATION_INCLUDED
+
+#include "../common/ph_model.hpp"
+
+namespace stream {
+namespace polyhedral {
+
+struct tabulation;
+struct invariant_hoisting;
+
+/*
+In statements of infinite arrays, replaces transcendental subexpressions
+which only depend on bounded indexes or on "i % P" for a constant P
+by reads from a finite table array. The table is computed once
+along with other finite arrays, rather than in every period.
+
+Tables with more than max_size elements are not created.
+*/
+void tabulate_periodic_expressions(model &, int max_size);
+
+/*
+In statements of infinite arrays, replaces subexpressions which
+do not depend on any index by reads from scalar arrays.
+These are computed once, before streaming starts.
+
+Such subexpressions consist of constants only, so the simplifier
+normally folds them already. This is only useful when simplification
+is disabled; otherwise, it would replace literals by loads.
+*/
+void hoist_invariant_expressions(model &);
+
+}
+}
+
+#endif // STREAM_LANG_POLYHEDRAL_TABULATION_INCLUDED
@@ -0,0 +1,17 @@
+#include "autocor_bench_kernel.cpp"
+#include "../drivers/benchmark.hpp"
+
+static const int num_samples = 1000;
+
+int main(int argc, char * argv[])
+{
+    benchmark::suite suite(argc, argv);
+
+    benchmark::kernel<autocorrelation::state<benchmark::kernel_io>> kernel;
+
+    suite.run("autocorrelation",
+              [&](){ kernel.initialize(); },
+              [&](){ return kernel.process(num_samples); });
+
+    return suite.finish();
+}
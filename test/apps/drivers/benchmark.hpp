@@ -0,0 +1,475 @@
+#ifndef ARRP_TEST_BENCHMARK_INCLUDED
+#define ARRP_TEST_BENCHMARK_INCLUDED
+
+// Benchmark harness for generated kernels and reference implementations.
+//
+// Each benchmark has a setup function (not timed) and a run function
+// (timed) which returns the number of samples it produced.
+// After warm-up runs, the run function is repeated and statistics
+// of run times are reported, along with hardware counters if
+// perf_event_open is available.
+//
+// Command line options of a benchmark program:
+//   --warmup <n>   Untimed runs before measurement. Default: 3
+//   --repeat <n>   Timed runs. Default: 30
+//   --json <file>  Write results to <file>.
+//   --filter <s>   Only run benchmarks whose name contains <s>.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define ARRP_BENCHMARK_PERF 1
+#endif
+
+namespace benchmark {
+
+using std::string;
+using std::vector;
+
+// Prevents the compiler from eliminating computation of 'value'.
+template <typename T>
+inline void do_not_optimize(const T & value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void * sink;
+    sink = &value;
+#endif
+}
+
+// IO object for kernels generated by arrp.
+// Consumes and counts outputs.
+struct kernel_io
+{
+    long outputs = 0;
+
+    template <typename T>
+    void output(T * data)
+    {
+        do_not_optimize(*data);
+        ++outputs;
+    }
+};
+
+// Runs a streaming kernel generated by arrp,
+// e.g. kernel<my_module::state<kernel_io>>.
+template <typename State>
+struct kernel
+{
+    std::unique_ptr<State> state;
+    kernel_io io;
+
+    void reset()
+    {
+        state.reset(new State);
+        state->io = &io;
+        io.outputs = 0;
+    }
+
+    void initialize()
+    {
+        reset();
+        state->initialize();
+    }
+
+    // Processes periods until at least 'samples' outputs are produced.
+    // Returns the number of outputs produced.
+    long process(long samples)
+    {
+        long start = io.outputs;
+        while (io.outputs - start < samples)
+            state->process();
+        return io.outputs - start;
+    }
+};
+
+struct options
+{
+    int warmup = 3;
+    int repetitions = 30;
+    string json_filename;
+    string filter;
+
+    bool parse(int argc, char * argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+            string value = argv[++i];
+            if (arg == "--warmup")
+                warmup = std::atoi(value.c_str());
+            else if (arg == "--repeat")
+                repetitions = std::max(1, std::atoi(value.c_str()));
+            else if (arg == "--json")
+                json_filename = value;
+            else if (arg == "--filter")
+                filter = value;
+            else
+                return false;
+        }
+        return true;
+    }
+};
+
+// Hardware event counts, summed over measured runs.
+struct counters
+{
+    enum event { cycles, instructions, cache_misses, branch_misses, event_count };
+
+    bool valid[event_count] = { false, false, false, false };
+    uint64_t value[event_count] = { 0, 0, 0, 0 };
+
+    static const char * name(int e)
+    {
+        static const char * names[] =
+        { "cycles", "instructions", "cache_misses", "branch_misses" };
+        return names[e];
+    }
+};
+
+// Hardware counters through Linux perf_event_open.
+// Unavailable on other systems, or when perf events are not permitted
+// (see /proc/sys/kernel/perf_event_paranoid).
+class perf_counters
+{
+public:
+    perf_counters()
+    {
+#ifdef ARRP_BENCHMARK_PERF
+        static const uint64_t configs[counters::event_count] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (int e = 0; e < counters::event_count; ++e)
+        {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[e];
+            attr.disabled = m_leader < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+
+            int fd = (int) syscall(__NR_perf_event_open, &attr, 0, -1, m_leader, 0);
+            if (fd < 0)
+            {
+                if (m_leader < 0)
+                    return;
+                continue;
+            }
+
+            if (m_leader < 0)
+                m_leader = fd;
+            m_fds.push_back(fd);
+            m_events.push_back(e);
+        }
+#endif
+    }
+
+    ~perf_counters()
+    {
+#ifdef ARRP_BENCHMARK_PERF
+        for (int fd : m_fds)
+            close(fd);
+#endif
+    }
+
+    bool available() const { return m_leader >= 0; }
+
+    void start()
+    {
+#ifdef ARRP_BENCHMARK_PERF
+        if (!available())
+            return;
+        ioctl(m_leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(m_leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void stop(counters & total)
+    {
+#ifdef ARRP_BENCHMARK_PERF
+        if (!available())
+            return;
+        ioctl(m_leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        uint64_t data[1 + counters::event_count];
+        if (read(m_leader, data, sizeof(data)) < (ssize_t) sizeof(uint64_t))
+            return;
+
+        int n = std::min<int>(data[0], m_events.size());
+        for (int i = 0; i < n; ++i)
+        {
+            total.valid[m_events[i]] = true;
+            total.value[m_events[i]] += data[1 + i];
+        }
+#else
+        (void) total;
+#endif
+    }
+
+private:
+    int m_leader = -1;
+    vector<int> m_fds;
+    vector<int> m_events;
+};
+
+struct result
+{
+    string name;
+    long samples = 0;
+    // Run times in nanoseconds, sorted.
+    vector<double> times;
+    counters events;
+
+    string baseline;
+    double speedup = 0;
+
+    double min() const { return times.front(); }
+    double max() const { return times.back(); }
+    double median() const { return percentile(0.5); }
+
+    double mean() const
+    {
+        double sum = 0;
+        for (double t : times)
+            sum += t;
+        return sum / times.size();
+    }
+
+    double percentile(double p) const
+    {
+        int index = (int) std::ceil(p * times.size()) - 1;
+        index = std::max(0, std::min<int>(index, times.size() - 1));
+        return times[index];
+    }
+
+    double ns_per_sample() const
+    {
+        return samples > 0 ? median() / samples : 0;
+    }
+
+    double samples_per_second() const
+    {
+        double ns = ns_per_sample();
+        return ns > 0 ? 1e9 / ns : 0;
+    }
+
+    // Per sample, over all measured runs.
+    double event_per_sample(int e) const
+    {
+        return samples > 0 ? double(events.value[e]) / (samples * times.size()) : 0;
+    }
+};
+
+class suite
+{
+public:
+    suite(int argc, char * argv[])
+    {
+        if (!m_options.parse(argc, argv))
+        {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--warmup <n>] [--repeat <n>] [--json <file>] [--filter <s>]"
+                      << std::endl;
+            std::exit(1);
+        }
+
+        if (!m_perf.available())
+            std::cerr << "Hardware counters not available." << std::endl;
+    }
+
+    template <typename Setup, typename Run>
+    void run(const string & name, Setup setup, Run run)
+    {
+        if (!m_options.filter.empty() && name.find(m_options.filter) == string::npos)
+            return;
+
+        using clock = std::chrono::steady_clock;
+
+        result r;
+        r.name = name;
+
+        for (int i = 0; i < m_options.warmup; ++i)
+        {
+            setup();
+            run();
+        }
+
+        for (int i = 0; i < m_options.repetitions; ++i)
+        {
+            setup();
+
+            m_perf.start();
+            auto start = clock::now();
+            long samples = run();
+            auto end = clock::now();
+            m_perf.stop(r.events);
+
+            r.samples = samples;
+            r.times.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+
+        std::sort(r.times.begin(), r.times.end());
+
+        print(r);
+
+        m_results.push_back(r);
+    }
+
+    // Reports speedup of a benchmark relative to a baseline benchmark,
+    // by median time per sample.
+    void compare(const string & name, const string & baseline)
+    {
+        auto r = find(name);
+        auto b = find(baseline);
+        if (!r || !b || r->ns_per_sample() <= 0)
+            return;
+
+        r->baseline = baseline;
+        r->speedup = b->ns_per_sample() / r->ns_per_sample();
+
+        auto precision = std::cout.precision(3);
+        std::cout << name << ": " << r->speedup
+                  << "x speedup over " << baseline << std::endl;
+        std::cout.precision(precision);
+    }
+
+    int finish()
+    {
+        if (!m_options.json_filename.empty())
+        {
+            std::ofstream file(m_options.json_filename);
+            if (!file.is_open())
+            {
+                std::cerr << "Can not open " << m_options.json_filename << std::endl;
+                return 1;
+            }
+            write_json(file);
+        }
+        return 0;
+    }
+
+private:
+    result * find(const string & name)
+    {
+        for (auto & r : m_results)
+        {
+            if (r.name == name)
+                return &r;
+        }
+        return nullptr;
+    }
+
+    void print(const result & r)
+    {
+        using namespace std;
+
+        auto flags = cout.flags();
+        auto precision = cout.precision();
+
+        cout << r.name << ":" << endl
+             << fixed << setprecision(2)
+             << "  " << r.ns_per_sample() << " ns/sample"
+             << "  " << setprecision(0) << r.samples_per_second() << " samples/s"
+             << setprecision(0)
+             << "  (" << r.samples << " samples/run;"
+             << " min " << r.min() << " ns,"
+             << " median " << r.median() << " ns,"
+             << " p90 " << r.percentile(0.9) << " ns,"
+             << " p99 " << r.percentile(0.99) << " ns)"
+             << endl;
+
+        if (r.events.valid[counters::cycles])
+        {
+            cout << "  " << setprecision(2)
+                 << r.event_per_sample(counters::cycles) << " cycles/sample";
+            if (r.events.valid[counters::instructions] && r.events.value[counters::cycles])
+            {
+                cout << "  IPC " << double(r.events.value[counters::instructions]) /
+                        r.events.value[counters::cycles];
+            }
+            if (r.events.valid[counters::cache_misses])
+                cout << "  " << r.event_per_sample(counters::cache_misses) << " cache misses/sample";
+            if (r.events.valid[counters::branch_misses])
+                cout << "  " << r.event_per_sample(counters::branch_misses) << " branch misses/sample";
+            cout << endl;
+        }
+
+        cout.flags(flags);
+        cout.precision(precision);
+    }
+
+    void write_json(std::ostream & out)
+    {
+        out << "{\"benchmarks\": [";
+        for (int i = 0; i < (int) m_results.size(); ++i)
+        {
+            auto & r = m_results[i];
+            out << (i > 0 ? "," : "") << std::endl << "  {"
+                << "\"name\": \"" << r.name << "\", "
+                << "\"samples\": " << r.samples << ", "
+                << "\"repetitions\": " << r.times.size() << ", "
+                << "\"min_ns\": " << r.min() << ", "
+                << "\"median_ns\": " << r.median() << ", "
+                << "\"mean_ns\": " << r.mean() << ", "
+                << "\"p90_ns\": " << r.percentile(0.9) << ", "
+                << "\"p99_ns\": " << r.percentile(0.99) << ", "
+                << "\"max_ns\": " << r.max() << ", "
+                << "\"ns_per_sample\": " << r.ns_per_sample() << ", "
+                << "\"samples_per_second\": " << r.samples_per_second();
+
+            out << ", \"counters_per_sample\": {";
+            bool first = true;
+            for (int e = 0; e < counters::event_count; ++e)
+            {
+                if (!r.events.valid[e])
+                    continue;
+                out << (first ? "" : ", ")
+                    << "\"" << counters::name(e) << "\": " << r.event_per_sample(e);
+                first = false;
+            }
+            out << "}";
+
+            if (!r.baseline.empty())
+            {
+                out << ", \"baseline\": \"" << r.baseline << "\""
+                    << ", \"speedup\": " << r.speedup;
+            }
+
+            out << "}";
+        }
+        out << std::endl << "]}" << std::endl;
+    }
+
+    options m_options;
+    perf_counters m_perf;
+    vector<result> m_results;
+};
+
+}
+
+#endif // ARRP_TEST_BENCHMARK_INCLUDED
@@ -0,0 +1,17 @@
+#include "fft_bench_kernel.cpp"
+#include "../drivers/benchmark.hpp"
+
+// The FFT is a finite program: all of it is computed on initialization.
+
+int main(int argc, char * argv[])
+{
+    benchmark::suite suite(argc, argv);
+
+    benchmark::kernel<fft::state<benchmark::kernel_io>> kernel;
+
+    suite.run("fft",
+              [&](){ kernel.reset(); },
+              [&](){ kernel.state->initialize(); return kernel.io.outputs; });
+
+    return suite.finish();
+}
@@ -0,0 +1,37 @@
+#include "fir_filter_bench_kernel.cpp"
+#include "fir_filter_reference.cpp"
+#include "../drivers/benchmark.hpp"
+
+static const int num_samples = 100000;
+
+namespace test2_ref {
+inline void output(fp_type * data)
+{
+    benchmark::do_not_optimize(*data);
+}
+}
+
+int main(int argc, char * argv[])
+{
+    benchmark::suite suite(argc, argv);
+
+    benchmark::kernel<fir_filter::state<benchmark::kernel_io>> kernel;
+
+    suite.run("fir_filter",
+              [&](){ kernel.initialize(); },
+              [&](){ return kernel.process(num_samples); });
+
+    test2_ref::state reference;
+
+    suite.run("fir_filter_reference",
+              [&](){ test2_ref::initialize(&reference); },
+              [&](){
+        for (int i = 0; i < num_samples; ++i)
+            test2_ref::process(&reference);
+        return long(num_samples);
+    });
+
+    suite.compare("fir_filter", "fir_filter_reference");
+
+    return suite.finish();
+}
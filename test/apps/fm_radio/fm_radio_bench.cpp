@@ -0,0 +1,26 @@
+#include "fm_radio_bench_kernel.cpp"
+#include "fm_radio_ref.cpp"
+#include "../drivers/benchmark.hpp"
+
+static const int num_samples = 500;
+
+int main(int argc, char * argv[])
+{
+    benchmark::suite suite(argc, argv);
+
+    benchmark::kernel<fm_radio::state<benchmark::kernel_io>> kernel;
+
+    suite.run("fm_radio",
+              [&](){ kernel.initialize(); },
+              [&](){ return kernel.process(num_samples); });
+
+    fm_radio_test reference;
+
+    suite.run("fm_radio_reference",
+              [&](){ reference.initialize(); },
+              [&](){ reference.run(); return long(num_samples); });
+
+    suite.compare("fm_radio", "fm_radio_reference");
+
+    return suite.finish();
+}
@@ -4,8 +4,12 @@
  * $Id: fmref.c,v 1.15 2003-11-05 18:13:10 dmaze Exp $
  */
 
+#ifdef ARRP_BENCHMARK
+#define CALLGRIND_TOGGLE_COLLECT
+#else
 #include "../drivers/test_driver.hpp"
 #include <valgrind/callgrind.h>
+#endif
 
 #ifdef raw
 #include <raw.h>
@@ -138,6 +142,7 @@ struct fm_radio_test
     }
 };
 
+#ifndef ARRP_BENCHMARK
 int main()
 {
 
@@ -159,6 +164,7 @@ int main()
     driver.go(*test, 3, 1000);
 #endif
 }
+#endif // ARRP_BENCHMARK
 
 void fb_compact(FloatBuffer *fb)
 {
@@ -0,0 +1,41 @@
+# Usage:
+# cmake -DARRP=<arrp> -DSOURCE=<file> -DIMPORT_DIR=<dir>
+#       -DOPTIONS=<arrp options> [-DMAX_TOTAL=<n>] -P check_buffer_sizes.cmake
+
+function(total_buffer_size options out)
+  separate_arguments(args UNIX_COMMAND "${options}")
+  execute_process(
+    COMMAND ${ARRP} ${SOURCE} -i ${IMPORT_DIR} --verbose storage ${args}
+    RESULT_VARIABLE result
+    OUTPUT_VARIABLE output
+    ERROR_VARIABLE error
+  )
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "arrp failed with '${options}':\n${error}")
+  endif()
+
+  string(REGEX MATCHALL " = [0-9]+" sizes "${output}")
+  set(total 0)
+  foreach(size ${sizes})
+    string(REGEX REPLACE " = " "" size "${size}")
+    math(EXPR total "${total} + ${size}")
+  endforeach()
+
+  message(STATUS "Total buffer size with '${options}': ${total}")
+  set(${out} ${total} PARENT_SCOPE)
+endfunction()
+
+total_buffer_size("${OPTIONS}" total)
+total_buffer_size("--sched-fusion min" min_total)
+
+if(total GREATER min_total)
+  message(FATAL_ERROR
+    "Buffers with '${OPTIONS}' (${total})"
+    " are larger than with min fusion (${min_total}).")
+endif()
+
+if(MAX_TOTAL AND total GREATER MAX_TOTAL)
+  message(FATAL_ERROR
+    "Buffers with '${OPTIONS}' (${total})"
+    " exceed the expected ${MAX_TOTAL}.")
+endif()
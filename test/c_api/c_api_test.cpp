@@ -0,0 +1,166 @@
+// Compares outputs of a kernel generated with --c-api, through
+// arrp-runtime and through the block functions, with those of the
+// generated state class.
+// Usage: <program> <kernel library> <kernel descriptor>
+
+#include ARRP_TEST_KERNEL_SOURCE
+#include ARRP_TEST_C_HEADER
+#include "runtime.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#define ARRP_TEST_CAT2(a,b) a##b
+#define ARRP_TEST_CAT(a,b) ARRP_TEST_CAT2(a,b)
+#define C_API(name) ARRP_TEST_CAT(ARRP_TEST_KERNEL, ARRP_TEST_CAT(_, name))
+
+using namespace std;
+
+using bytes = vector<unsigned char>;
+
+struct reference_io
+{
+    bytes data;
+
+    template <typename T>
+    void output(T * value)
+    {
+        using state = ARRP_TEST_KERNEL::state<reference_io>;
+        auto b = reinterpret_cast<const unsigned char*>(value);
+        data.insert(data.end(), b, b + sizeof(T) * state::output_element_count);
+    }
+};
+
+static bool failed = false;
+
+static void check(bool ok, const string & what)
+{
+    if (!ok)
+    {
+        cerr << "Failed: " << what << endl;
+        failed = true;
+    }
+}
+
+int main(int argc, char * argv[])
+{
+    if (argc != 3)
+    {
+        cerr << "Usage: " << argv[0] << " <kernel library> <kernel descriptor>" << endl;
+        return 1;
+    }
+
+    using state_type = ARRP_TEST_KERNEL::state<reference_io>;
+
+    const long period = state_type::output_period_count;
+    const long count = 4410;
+    const size_t output_size =
+            sizeof(state_type::output_type) * state_type::output_element_count;
+
+    if (period < 1)
+    {
+        cerr << "Kernel must be a stream." << endl;
+        return 1;
+    }
+
+    const long periods = (count + period - 1) / period;
+
+    check(C_API(output_scalar_count) > 0, "output scalar count");
+    check(long(C_API(output_period_count)) == period, "output period count");
+    check(long(C_API(staging_latency)) == max(period - 1, 0L), "staging latency");
+
+    // Reference
+
+    reference_io ref_io;
+    size_t init_bytes;
+    {
+        unique_ptr<state_type> s(new state_type);
+        s->io = &ref_io;
+        s->initialize();
+        init_bytes = ref_io.data.size();
+        for (long p = 0; p < periods; ++p)
+            s->process();
+    }
+
+    check(init_bytes == state_type::output_init_count * output_size,
+          "reference output count");
+
+    bytes ref_init(ref_io.data.begin(), ref_io.data.begin() + init_bytes);
+    bytes ref_periods(ref_io.data.begin() + init_bytes,
+                      ref_io.data.begin() + init_bytes + count * output_size);
+
+    // Runtime
+
+    {
+        stream::runtime::kernel k(argv[1], argv[2]);
+        check(size_t(k.output_size()) == output_size, "runtime output size");
+
+        bytes data;
+        auto sink = [&](const void * d, int n)
+        {
+            auto b = static_cast<const unsigned char*>(d);
+            data.insert(data.end(), b, b + n * k.output_size());
+        };
+
+        k.initialize(sink);
+        check(data == ref_init, "runtime initialize outputs");
+
+        data.clear();
+        for (long p = 0; p < periods; ++p)
+            k.process(sink);
+        data.resize(ref_periods.size());
+        check(data == ref_periods, "runtime process outputs");
+    }
+
+    // Blocks of different sizes, including those which are
+    // not a multiple of the period and so use staging.
+
+    // The first is a single long block, which the others are compared with.
+    vector<long> block_sizes = { count, 1, period - 1, period, period + 1, 441 };
+    bytes single_block;
+
+    for (long block_size : block_sizes)
+    {
+        if (block_size < 1)
+            continue;
+
+        string name = "block size " + to_string(block_size);
+
+        void * s = C_API(create)();
+
+        bytes init(ref_init.size() + 1);
+        void * init_out[] = { init.data() };
+        check(C_API(reset)(s, init_out) == state_type::output_init_count,
+              name + ": reset result");
+        init.pop_back();
+        check(init == ref_init, name + ": reset outputs");
+
+        bytes data(ref_periods.size());
+        long done = 0;
+        while (done < count)
+        {
+            long n = min(block_size, count - done);
+            void * out[] = { data.data() + done * output_size };
+            long result = C_API(process_block)(s, nullptr, out, n);
+            check(result == n, name + ": process_block result");
+            if (result != n)
+                break;
+            done += n;
+        }
+        check(data == ref_periods, name + ": process_block outputs");
+        if (block_size == count)
+            single_block = data;
+        else
+            check(data == single_block, name + ": outputs differ from single block");
+
+        C_API(destroy)(s);
+    }
+
+    if (failed)
+        return 1;
+
+    cout << "Passed." << endl;
+    return 0;
+}
@@ -0,0 +1,326 @@
+// Generates synthetic Arrp programs of increasing size,
+// compiles each with "arrp --time-passes json",
+// and reports how time and memory of each pass grow with size.
+//
+// Exits with an error if the time of a checked pass grows faster
+// than size to the power of --max-exponent between the two
+// largest sizes of a shape.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const char * prelude =
+R"(fold(f,a) = {
+  let folding = [#a:
+    0 -> a[0];
+    k -> f(a[k], this[k-1]);
+  ];
+  folding[#a-1];
+};
+
+add(a,b) = a + b;
+
+sum(a) = fold(add, a);
+
+slice(pos,len,a) = [len: j -> a[pos + j]];
+
+fir(coefs, x) = [*: t -> sum(slice(t, #coefs, x) * coefs)];
+
+)";
+
+string coefs(int k, int taps)
+{
+    ostringstream text;
+    text << "c" << k << " = [" << taps << ": i -> 1.0 / (i + " << k << ")];" << endl;
+    return text.str();
+}
+
+// A chain of n FIR filters, each filtering the previous one.
+string filter_chain(int n)
+{
+    ostringstream text;
+    text << prelude;
+    text << "x0 = [*: t -> sin(t * 0.01)];" << endl;
+    for (int k = 1; k <= n; ++k)
+    {
+        text << coefs(k, 16);
+        text << "x" << k << " = fir(c" << k << ", x" << k-1 << ");" << endl;
+    }
+    text << "main = x" << n << ";" << endl;
+    return text.str();
+}
+
+// A bank of n FIR filters of the same input, summed.
+string filter_bank(int n)
+{
+    ostringstream text;
+    text << prelude;
+    text << "x = [*: t -> sin(t * 0.01)];" << endl;
+    for (int k = 1; k <= n; ++k)
+    {
+        text << coefs(k, 16);
+        text << "b" << k << " = fir(c" << k << ", x);" << endl;
+    }
+    text << "main = [*: t -> ";
+    for (int k = 1; k <= n; ++k)
+        text << (k > 1 ? " + " : "") << "b" << k << "[t]";
+    text << "];" << endl;
+    return text.str();
+}
+
+// A single FIR filter with n taps.
+string filter_taps(int n)
+{
+    ostringstream text;
+    text << prelude;
+    text << "x = [*: t -> sin(t * 0.01)];" << endl;
+    text << coefs(1, n);
+    text << "main = fir(c1, x);" << endl;
+    return text.str();
+}
+
+// A stream of n-dimensional arrays, reduced by n nested folds.
+string fold_nest(int n)
+{
+    auto vars = [](int count) {
+        ostringstream text;
+        text << "t";
+        for (int i = 1; i <= count; ++i)
+            text << ", i" << i;
+        return text.str();
+    };
+    auto sizes = [](int count) {
+        ostringstream text;
+        text << "*";
+        for (int i = 1; i <= count; ++i)
+            text << ",4";
+        return text.str();
+    };
+
+    ostringstream text;
+    text << prelude;
+    text << "s" << n << " = [" << sizes(n) << ": " << vars(n) << " -> sin(t * 0.01";
+    for (int i = 1; i <= n; ++i)
+        text << " + i" << i;
+    text << ")];" << endl;
+    for (int k = n - 1; k >= 0; --k)
+    {
+        text << "s" << k << " = [" << sizes(k) << ": " << vars(k) << " -> "
+             << "sum(s" << k + 1 << "[" << vars(k) << "])];" << endl;
+    }
+    text << "main = s0;" << endl;
+    return text.str();
+}
+
+// n instantiations of a function, each with a different window size.
+string instantiations(int n)
+{
+    ostringstream text;
+    text << prelude;
+    text << "smooth(len, x) = [*: t -> sum(slice(t, len, x)) / len];" << endl;
+    text << "x = [*: t -> sin(t * 0.01)];" << endl;
+    text << "main = [*: t -> ";
+    for (int k = 1; k <= n; ++k)
+        text << (k > 1 ? " + " : "") << "smooth(" << k + 1 << ", x)[t]";
+    text << "];" << endl;
+    return text.str();
+}
+
+struct shape
+{
+    string name;
+    function<string(int)> generate;
+    vector<int> sizes;
+};
+
+struct pass_result
+{
+    double wall_ms = 0;
+    double rss_kb = 0;
+};
+
+typedef map<string, pass_result> run_result;
+
+bool run_arrp(const string & arrp, const string & source, run_result & result)
+{
+    string command = arrp + " " + source + " --time-passes json 2>&1";
+
+    FILE * pipe = popen(command.c_str(), "r");
+    if (!pipe)
+        return false;
+
+    string output;
+    char buffer[4096];
+    while (size_t count = fread(buffer, 1, sizeof(buffer), pipe))
+        output.append(buffer, count);
+
+    if (pclose(pipe) != 0)
+    {
+        cerr << output;
+        return false;
+    }
+
+    regex pass_regex("\"name\": \"([^\"]*)\".*\"wall_ms\": ([0-9.e+-]+).*"
+                     "\"peak_rss_growth_kb\": ([0-9-]+)");
+
+    istringstream lines(output);
+    string line;
+    while(getline(lines, line))
+    {
+        smatch match;
+        if (!regex_search(line, match, pass_regex))
+            continue;
+        auto & r = result[match[1]];
+        r.wall_ms = stod(match[2]);
+        r.rss_kb = stod(match[3]);
+        result["total"].wall_ms += r.wall_ms;
+        result["total"].rss_kb += r.rss_kb;
+    }
+
+    return !result.empty();
+}
+
+}
+
+int main(int argc, char * argv[])
+{
+    string arrp = "arrp";
+    string work_dir = ".";
+    string json_filename = "scalability.json";
+    double max_exponent = 1.5;
+    // Below this, times are too noisy to compare.
+    double min_time_ms = 10;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        auto next = [&]() -> string {
+            if (i + 1 >= argc)
+            {
+                cerr << "Missing argument for " << arg << endl;
+                exit(1);
+            }
+            return argv[++i];
+        };
+
+        if (arg == "--arrp")
+            arrp = next();
+        else if (arg == "--work-dir")
+            work_dir = next();
+        else if (arg == "--json")
+            json_filename = next();
+        else if (arg == "--max-exponent")
+            max_exponent = stod(next());
+        else
+        {
+            cerr << "Usage: " << argv[0]
+                 << " [--arrp <arrp>] [--work-dir <dir>] [--json <file>]"
+                 << " [--max-exponent <e>]" << endl;
+            return 1;
+        }
+    }
+
+    vector<shape> shapes = {
+        { "chain", filter_chain, { 1, 2, 4, 8, 16, 32 } },
+        { "bank", filter_bank, { 1, 2, 4, 8, 16, 32 } },
+        { "taps", filter_taps, { 16, 64, 256, 1024 } },
+        { "nest", fold_nest, { 1, 2, 3, 4, 5 } },
+        { "instances", instantiations, { 1, 2, 4, 8, 16, 32 } }
+    };
+
+    vector<string> checked_passes = {
+        "function reduction", "array reduction", "scheduling", "total"
+    };
+
+    ofstream json(json_filename);
+    json << "{";
+
+    bool ok = true;
+
+    for (int s = 0; s < (int) shapes.size(); ++s)
+    {
+        auto & sh = shapes[s];
+
+        cout << endl << "== " << sh.name << " ==" << endl;
+        cout << setw(6) << "size";
+        for (auto & pass : checked_passes)
+            cout << setw(20) << pass;
+        cout << setw(14) << "RSS +KB" << endl;
+
+        json << (s > 0 ? "," : "") << endl << "  \"" << sh.name << "\": [";
+
+        vector<pair<int, run_result>> results;
+
+        for (int size : sh.sizes)
+        {
+            string source = work_dir + "/" + sh.name + "_" + to_string(size) + ".stream";
+            {
+                ofstream file(source);
+                file << sh.generate(size);
+            }
+
+            run_result result;
+            if (!run_arrp(arrp, source, result))
+            {
+                cout << setw(6) << size << "  failed" << endl;
+                ok = false;
+                continue;
+            }
+
+            json << (results.empty() ? "" : ",") << endl
+                 << "    {\"size\": " << size;
+            for (auto & entry : result)
+                json << ", \"" << entry.first << "\": " << entry.second.wall_ms;
+            json << ", \"rss_kb\": " << (long) result["total"].rss_kb << "}";
+
+            cout << setw(6) << size << fixed << setprecision(2);
+            for (auto & pass : checked_passes)
+                cout << setw(20) << result[pass].wall_ms;
+            cout << setw(14) << (long) result["total"].rss_kb << endl;
+
+            results.emplace_back(size, result);
+        }
+
+        json << endl << "  ]";
+
+        if (results.size() < 2)
+            continue;
+
+        auto & small = results[results.size()-2];
+        auto & large = results.back();
+
+        for (auto & pass : checked_passes)
+        {
+            double t1 = small.second[pass].wall_ms;
+            double t2 = large.second[pass].wall_ms;
+            if (t2 < min_time_ms || t1 <= 0)
+                continue;
+
+            double exponent = log(t2 / t1) / log(double(large.first) / small.first);
+            if (exponent > max_exponent)
+            {
+                cout << "** Super-linear growth of " << pass << ": "
+                     << "time ~ size^" << setprecision(2) << exponent << endl;
+                ok = false;
+            }
+        }
+    }
+
+    json << endl << "}" << endl;
+
+    return ok ? 0 : 1;
+}
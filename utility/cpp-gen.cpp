@@ -186,6 +186,35 @@ void array_decl::generate(cpp_gen::state & state, ostream & stream)
     }
 }
 
+void static_constant::generate(cpp_gen::state & state, ostream & stream)
+{
+    stream << "static constexpr ";
+    type->generate(state, stream);
+    stream << ' ' << name << " = ";
+    value->generate(state, stream);
+    stream << ';';
+}
+
+void static_constant_def::generate(cpp_gen::state & state, ostream & stream)
+{
+    if (template_parameters.size())
+    {
+        stream << "template <";
+        for(int i = 0; i < template_parameters.size(); ++i)
+        {
+            if (i > 0)
+                stream << ", ";
+            stream << "typename " << template_parameters[i];
+        }
+        stream << ">";
+        state.new_line(stream);
+    }
+
+    stream << "constexpr ";
+    type->generate(state, stream);
+    stream << ' ' << class_name << "::" << name << ';';
+}
+
 void func_signature::generate(cpp_gen::state & state, ostream & stream)
 {
     if (template_parameters.size())
@@ -302,6 +331,10 @@ static int precedence(expression_ptr expr)
     {
         return precedence(op::array_subscript);
     }
+    else if (dynamic_cast<if_expression*>(expr.get()))
+    {
+        return precedence(op::conditional);
+    }
     else
     {
         return 0;
@@ -520,6 +553,48 @@ void expr_statement::generate(cpp_gen::state & state, ostream & stream)
     stream << ";";
 }
 
+static const char * restore_line_marker = "#line __restore__";
+
+void line_directive::generate(cpp_gen::state &, ostream & stream)
+{
+    if (file.empty())
+    {
+        stream << restore_line_marker;
+        return;
+    }
+
+    stream << "#line " << line << " ";
+    print_literal(stream, file);
+}
+
+string restore_line_directives(const string & code, const string & file)
+{
+    std::istringstream in(code);
+    ostringstream out;
+    string line;
+    int line_number = 0;
+
+    while(std::getline(in, line))
+    {
+        ++line_number;
+
+        auto pos = line.find_first_not_of(" \t");
+        if (pos != string::npos && line.compare(pos, string::npos, restore_line_marker) == 0)
+        {
+            line.replace(pos, string::npos, "#line " + std::to_string(line_number + 1) + " ");
+            out << line;
+            print_literal(out, file);
+            out << '\n';
+        }
+        else
+        {
+            out << line << '\n';
+        }
+    }
+
+    return out.str();
+}
+
 void if_statement::generate(cpp_gen::state & state, ostream & stream)
 {
     stream << "if (";
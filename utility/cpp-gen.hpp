@@ -378,6 +378,34 @@ public:
     func_decl(func_sig_ptr sig): signature(sig) {}
 };
 
+// Declares 'static constexpr <type> <name> = <value>;' in a class.
+class static_constant : public class_member
+{
+public:
+    type_ptr type;
+    string name;
+    expression_ptr value;
+
+    static_constant(type_ptr type, const string & name, expression_ptr value):
+        type(type), name(name), value(value) {}
+    void generate(state &, ostream &);
+};
+
+// Defines a static constant outside its class,
+// as required in C++11 if the constant is odr-used.
+class static_constant_def : public namespace_member
+{
+public:
+    vector<string> template_parameters;
+    string class_name;
+    type_ptr type;
+    string name;
+
+    static_constant_def(const string & class_name, type_ptr type, const string & name):
+        class_name(class_name), type(type), name(name) {}
+    void generate(state &, ostream &);
+};
+
 class using_decl : public namespace_member, public class_member
 {
 public:
@@ -430,6 +458,18 @@ inline void print_literal(ostream & stream, float v)
     stream << buf;
 }
 
+inline void print_literal(ostream & stream, const string & v)
+{
+    stream << '"';
+    for (char c : v)
+    {
+        if (c == '"' || c == '\\')
+            stream << '\\';
+        stream << c;
+    }
+    stream << '"';
+}
+
 template <typename T>
 class literal_expression : public expression
 {
@@ -714,6 +754,24 @@ public:
     }
 };
 
+// Sets the source file and line reported by the C++ compiler
+// for the following code. Without a file, it marks where reporting
+// should return to the generated file, see restore_line_directives.
+class line_directive : public statement
+{
+public:
+    int line;
+    string file;
+
+    line_directive(int line = 0, const string & file = string()):
+        line(line), file(file) {}
+    void generate(state &, ostream & stream);
+};
+
+// Replaces markers left by line directives without a file
+// with directives referring to 'file' at the following line.
+string restore_line_directives(const string & code, const string & file);
+
 class return_statement : public statement
 {
 public: